@@ -0,0 +1,375 @@
+// Cost of the primitive tests in Geometry3D. Every test runs over the
+// same seeded random shapes on every build, so two runs can be compared.
+// Usage: GeometryBenchmark [opsPerTest] [baseline.csv]
+// Prints test,ops,ns_per_op,hit_rate as CSV. If a baseline (the output
+// of an earlier run) is given, it's ns_per_op and the speedup are
+// added as two more columns.
+// Hit rate is the fraction of tests that returned true. For
+// ClosestPoint it's the fraction of points that were already on or
+// inside the shape.
+// SATProjected is the box-box test that projects every corner on all
+// 15 axis, SATRelativeRotation is OBBOBBPenetration. How often the two
+// agree is written to stderr.
+// The GJK rows run the general GJK / EPA test on pairs that also have
+// a hand written test (boxes, spheres and capsules), which of the two
+// is faster is written to stderr.
+// The RoundHull rows use a hull built by Quickhull from points on a
+// sphere, once with the hill climbing support function and once
+// (Scan) with the support function checking every vertex.
+// The Mesh rows collide shapes with the triangles of the model through
+// a MeshCollider, Triangle rows are the single triangle tests it uses.
+
+#include "../Code/Geometry3D.h"
+#include "../Code/GJK.h"
+#include "../Code/QuickHull.h"
+#include "../Code/MeshCollider.h"
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+#define NUM_SHAPES 4096
+#define NUM_HULL_VERTICES 32
+#define NUM_ROUND_HULL_POINTS 512
+
+// Small LCG instead of rand, so inputs match on every platform
+static unsigned int randomState = 1234;
+
+static float Random(float min, float max) {
+	randomState = randomState * 1664525u + 1013904223u;
+	float random = (float)(randomState >> 8) / (float)(1 << 24);
+	return (random * (max - min)) + min;
+}
+
+static vec3 RandomPoint(float extent) {
+	return vec3(Random(-extent, extent), Random(-extent, extent), Random(-extent, extent));
+}
+
+static vec3 RandomDirection() {
+	vec3 dir;
+	do {
+		dir = RandomPoint(1.0f);
+	} while (MagnitudeSq(dir) < 0.0001f);
+	return Normalized(dir);
+}
+
+// Shapes are spread over a 10 unit cube and are up to 2 units
+// big, so most of the tests hit some of the time
+typedef struct Inputs {
+	std::vector<Point> points;
+	std::vector<Sphere> spheres;
+	std::vector<AABB> aabbs;
+	std::vector<OBB> obbs;
+	std::vector<Capsule> capsules;
+	std::vector<ConvexHull> hulls;
+	std::vector<Point> hullVertices; // Shared by all hulls
+	HullMesh roundHull; // Shared by all round hulls
+	std::vector<ConvexHull> roundHulls;
+	std::vector<ConvexHull> roundHullsScan; // Without adjacency
+	std::vector<Plane> planes;
+	std::vector<Triangle> triangles;
+	std::vector<Line> lines;
+	std::vector<Ray> rays;
+	Mesh mesh;
+	Model model;
+	MeshCollider meshCollider;
+} Inputs;
+
+static void CreateInputs(Inputs& in) {
+	const float extent = 5.0f;
+	for (int i = 0; i < NUM_HULL_VERTICES; ++i) {
+		in.hullVertices.push_back(RandomDirection() * Random(0.5f, 1.5f));
+	}
+	std::vector<Point> roundPoints;
+	for (int i = 0; i < NUM_ROUND_HULL_POINTS; ++i) {
+		roundPoints.push_back(RandomDirection() * 1.5f);
+	}
+	BuildConvexHull(&roundPoints[0], NUM_ROUND_HULL_POINTS, &in.roundHull, 0);
+	for (int i = 0; i < NUM_SHAPES; ++i) {
+		in.points.push_back(RandomPoint(extent));
+		in.spheres.push_back(Sphere(RandomPoint(extent), Random(0.25f, 2.0f)));
+		in.aabbs.push_back(AABB(RandomPoint(extent), vec3(Random(0.25f, 2.0f), Random(0.25f, 2.0f), Random(0.25f, 2.0f))));
+		in.obbs.push_back(OBB(RandomPoint(extent), vec3(Random(0.25f, 2.0f), Random(0.25f, 2.0f), Random(0.25f, 2.0f)),
+			Rotation3x3(Random(0.0f, 360.0f), Random(0.0f, 360.0f), Random(0.0f, 360.0f))));
+		in.capsules.push_back(Capsule(RandomPoint(extent), Random(0.25f, 1.0f), Random(0.25f, 1.5f),
+			Rotation3x3(Random(0.0f, 360.0f), Random(0.0f, 360.0f), Random(0.0f, 360.0f))));
+		ConvexHull hull(RandomPoint(extent), &in.hullVertices[0], NUM_HULL_VERTICES);
+		hull.orientation = Rotation3x3(Random(0.0f, 360.0f), Random(0.0f, 360.0f), Random(0.0f, 360.0f));
+		in.hulls.push_back(hull);
+		ConvexHull roundHull = GetConvexHull(in.roundHull, RandomPoint(extent), hull.orientation);
+		in.roundHulls.push_back(roundHull);
+		roundHull.adjacencyStart = 0;
+		roundHull.adjacency = 0;
+		in.roundHullsScan.push_back(roundHull);
+		in.planes.push_back(Plane(RandomDirection(), Random(-extent, extent)));
+		vec3 center = RandomPoint(extent);
+		in.triangles.push_back(Triangle(center + RandomPoint(1.5f), center + RandomPoint(1.5f), center + RandomPoint(1.5f)));
+		vec3 start = RandomPoint(extent);
+		in.lines.push_back(Line(start, start + RandomDirection() * Random(0.5f, 4.0f)));
+		in.rays.push_back(Ray(RandomPoint(extent * 2.0f), RandomDirection()));
+	}
+
+	// Small triangles across the cube, with a BVH
+	in.mesh.numTriangles = 1024;
+	in.mesh.triangles = new Triangle[in.mesh.numTriangles];
+	for (int i = 0; i < in.mesh.numTriangles; ++i) {
+		vec3 center = RandomPoint(extent);
+		in.mesh.triangles[i] = Triangle(center + RandomPoint(0.5f), center + RandomPoint(0.5f), center + RandomPoint(0.5f));
+	}
+	AccelerateMesh(in.mesh);
+	in.model.SetContent(&in.mesh);
+	in.model.position = vec3(0.5f, 0.0f, 0.0f);
+	in.model.rotation = vec3(0.0f, 30.0f, 0.0f);
+	BuildMeshCollider(&in.model, &in.meshCollider);
+}
+
+// The separating axis test as FindCollisionFeatures used to do it,
+// projecting both boxes on every axis
+static bool ProjectedSAT(const OBB& A, const OBB& B, vec3* outNormal, float* outDepth) {
+	const float* o1 = A.orientation.asArray;
+	const float* o2 = B.orientation.asArray;
+	vec3 test[15] = {
+		vec3(o1[0], o1[1], o1[2]), vec3(o1[3], o1[4], o1[5]), vec3(o1[6], o1[7], o1[8]),
+		vec3(o2[0], o2[1], o2[2]), vec3(o2[3], o2[4], o2[5]), vec3(o2[6], o2[7], o2[8])
+	};
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			test[6 + i * 3 + j] = Cross(test[i], test[3 + j]);
+		}
+	}
+
+	*outDepth = FLT_MAX;
+	bool shouldFlip;
+	for (int i = 0; i < 15; ++i) {
+		if (MagnitudeSq(test[i]) < 0.001f) {
+			continue;
+		}
+		float depth = PenetrationDepth(A, B, test[i], &shouldFlip);
+		if (depth <= 0.0f) {
+			return false;
+		}
+		if (depth < *outDepth) {
+			*outDepth = depth;
+			*outNormal = Normalized(shouldFlip ? test[i] * -1.0f : test[i]);
+		}
+	}
+	return true;
+}
+
+// Both tests should find the same overlap and depth for every pair
+static void CompareSAT(const std::vector<OBB>& obbs) {
+	int pairs = 0, hitMismatches = 0, depthMismatches = 0;
+	for (int i = 0, size = obbs.size(); i < size; ++i) {
+		int j = (i * 7 + 3) % size;
+		vec3 n1, n2;
+		float d1, d2;
+		bool hit1 = ProjectedSAT(obbs[i], obbs[j], &n1, &d1);
+		bool hit2 = OBBOBBPenetration(obbs[i], obbs[j], &n2, &d2) && d2 > 0.0f;
+		pairs += 1;
+		if (hit1 != hit2) {
+			hitMismatches += 1;
+		}
+		else if (hit1 && fabsf(d1 - d2) > 0.001f) {
+			depthMismatches += 1;
+		}
+	}
+	fprintf(stderr, "SAT: %d pairs, %d disagree on overlap, %d on depth\n", pairs, hitMismatches, depthMismatches);
+}
+
+typedef struct Result {
+	std::string name;
+	int ops;
+	double nsPerOp;
+	double hitRate;
+} Result;
+
+static void CompareDispatch(const char* pair, const Result& specialised, const Result& gjk) {
+	fprintf(stderr, "%s: hand written %.2f ns, GJK %.2f ns, %s is %.2fx faster\n", pair, specialised.nsPerOp, gjk.nsPerOp,
+		specialised.nsPerOp <= gjk.nsPerOp ? "hand written" : "GJK",
+		specialised.nsPerOp <= gjk.nsPerOp ? gjk.nsPerOp / specialised.nsPerOp : specialised.nsPerOp / gjk.nsPerOp);
+}
+
+static volatile int sink = 0;
+
+// Calls test(i, j) ops times, j walks the shapes at a different
+// rate than i so every shape meets many others
+template<typename Test>
+static Result Run(const char* name, int ops, Test test) {
+	// Warm up the caches and branch predictors
+	int hits = 0;
+	for (int i = 0; i < NUM_SHAPES; ++i) {
+		hits += test(i, (i * 7 + 3) % NUM_SHAPES) ? 1 : 0;
+	}
+
+	hits = 0;
+	Clock::time_point start = Clock::now();
+	for (int k = 0; k < ops; ++k) {
+		int i = k % NUM_SHAPES;
+		int j = (k * 7 + k / NUM_SHAPES + 3) % NUM_SHAPES;
+		hits += test(i, j) ? 1 : 0;
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	sink += hits;
+
+	Result result;
+	result.name = name;
+	result.ops = ops;
+	result.nsPerOp = seconds * 1e9 / (double)ops;
+	result.hitRate = (double)hits / (double)ops;
+	return result;
+}
+
+static std::map<std::string, double> LoadBaseline(const char* path) {
+	std::map<std::string, double> baseline;
+	FILE* file = fopen(path, "r");
+	if (file == 0) {
+		fprintf(stderr, "Could not open baseline: %s\n", path);
+		return baseline;
+	}
+	char line[512];
+	while (fgets(line, sizeof(line), file) != 0) {
+		char name[256];
+		int ops;
+		double nsPerOp;
+		if (sscanf(line, "%255[^,],%d,%lf", name, &ops, &nsPerOp) == 3) {
+			baseline[name] = nsPerOp;
+		}
+	}
+	fclose(file);
+	return baseline;
+}
+
+int main(int argc, char** argv) {
+	int ops = (argc > 1) ? atoi(argv[1]) : 1000000;
+	const char* baselinePath = (argc > 2) ? argv[2] : 0;
+	// Manifold generation allocates, run fewer of those
+	int slowOps = ops / 10 > 0 ? ops / 10 : 1;
+
+	Inputs in;
+	CreateInputs(in);
+	const Inputs& c = in;
+
+	std::vector<Result> results;
+	RaycastResult ray;
+
+	// Pair tests
+	results.push_back(Run("SphereSphere", ops, [&](int i, int j) { return SphereSphere(c.spheres[i], c.spheres[j]); }));
+	results.push_back(Run("SphereAABB", ops, [&](int i, int j) { return SphereAABB(c.spheres[i], c.aabbs[j]); }));
+	results.push_back(Run("SphereOBB", ops, [&](int i, int j) { return SphereOBB(c.spheres[i], c.obbs[j]); }));
+	results.push_back(Run("SpherePlane", ops, [&](int i, int j) { return SpherePlane(c.spheres[i], c.planes[j]); }));
+	results.push_back(Run("AABBAABB", ops, [&](int i, int j) { return AABBAABB(c.aabbs[i], c.aabbs[j]); }));
+	results.push_back(Run("AABBOBB", ops, [&](int i, int j) { return AABBOBB(c.aabbs[i], c.obbs[j]); }));
+	results.push_back(Run("AABBPlane", ops, [&](int i, int j) { return AABBPlane(c.aabbs[i], c.planes[j]); }));
+	results.push_back(Run("OBBOBB", ops, [&](int i, int j) { return OBBOBB(c.obbs[i], c.obbs[j]); }));
+	vec3 satNormal;
+	float satDepth;
+	results.push_back(Run("SATProjected", ops, [&](int i, int j) { return ProjectedSAT(c.obbs[i], c.obbs[j], &satNormal, &satDepth); }));
+	results.push_back(Run("SATRelativeRotation", ops, [&](int i, int j) { return OBBOBBPenetration(c.obbs[i], c.obbs[j], &satNormal, &satDepth); }));
+	CompareSAT(c.obbs);
+	results.push_back(Run("OBBPlane", ops, [&](int i, int j) { return OBBPlane(c.obbs[i], c.planes[j]); }));
+	results.push_back(Run("PlanePlane", ops, [&](int i, int j) { return PlanePlane(c.planes[i], c.planes[j]); }));
+	results.push_back(Run("TriangleSphere", ops, [&](int i, int j) { return TriangleSphere(c.triangles[i], c.spheres[j]); }));
+	results.push_back(Run("TriangleAABB", ops, [&](int i, int j) { return TriangleAABB(c.triangles[i], c.aabbs[j]); }));
+	results.push_back(Run("TriangleOBB", ops, [&](int i, int j) { return TriangleOBB(c.triangles[i], c.obbs[j]); }));
+	results.push_back(Run("TrianglePlane", ops, [&](int i, int j) { return TrianglePlane(c.triangles[i], c.planes[j]); }));
+	results.push_back(Run("TriangleTriangle", ops, [&](int i, int j) { return TriangleTriangle(c.triangles[i], c.triangles[j]); }));
+	results.push_back(Run("TriangleTriangleRobust", ops, [&](int i, int j) { return TriangleTriangleRobust(c.triangles[i], c.triangles[j]); }));
+
+	// Raycasts and line tests
+	results.push_back(Run("RaycastSphere", ops, [&](int i, int j) { return Raycast(c.spheres[j], c.rays[i], &ray); }));
+	results.push_back(Run("RaycastAABB", ops, [&](int i, int j) { return Raycast(c.aabbs[j], c.rays[i], &ray); }));
+	results.push_back(Run("RaycastOBB", ops, [&](int i, int j) { return Raycast(c.obbs[j], c.rays[i], &ray); }));
+	results.push_back(Run("RaycastPlane", ops, [&](int i, int j) { return Raycast(c.planes[j], c.rays[i], &ray); }));
+	results.push_back(Run("RaycastTriangle", ops, [&](int i, int j) { return Raycast(c.triangles[j], c.rays[i], &ray); }));
+	results.push_back(Run("RaycastCapsule", ops, [&](int i, int j) { return Raycast(c.capsules[j], c.rays[i], &ray); }));
+	results.push_back(Run("RaycastMesh", slowOps, [&](int i, int) { return Raycast(c.mesh, c.rays[i]) >= 0.0f; }));
+	results.push_back(Run("RaycastModel", slowOps, [&](int i, int) { return Raycast(c.model, c.rays[i]) >= 0.0f; }));
+	results.push_back(Run("LinetestSphere", ops, [&](int i, int j) { return Linetest(c.spheres[j], c.lines[i]); }));
+	results.push_back(Run("LinetestAABB", ops, [&](int i, int j) { return Linetest(c.aabbs[j], c.lines[i]); }));
+	results.push_back(Run("LinetestOBB", ops, [&](int i, int j) { return Linetest(c.obbs[j], c.lines[i]); }));
+	results.push_back(Run("LinetestPlane", ops, [&](int i, int j) { return Linetest(c.planes[j], c.lines[i]); }));
+	results.push_back(Run("LinetestTriangle", ops, [&](int i, int j) { return Linetest(c.triangles[j], c.lines[i]); }));
+	results.push_back(Run("LinetestCapsule", ops, [&](int i, int j) { return Linetest(c.capsules[j], c.lines[i]); }));
+
+	// Closest points, a hit is a point that didn't move
+	results.push_back(Run("ClosestPointSphere", ops, [&](int i, int j) { return ClosestPoint(c.spheres[j], c.points[i]) == c.points[i]; }));
+	results.push_back(Run("ClosestPointAABB", ops, [&](int i, int j) { return ClosestPoint(c.aabbs[j], c.points[i]) == c.points[i]; }));
+	results.push_back(Run("ClosestPointOBB", ops, [&](int i, int j) { return ClosestPoint(c.obbs[j], c.points[i]) == c.points[i]; }));
+	results.push_back(Run("ClosestPointPlane", ops, [&](int i, int j) { return ClosestPoint(c.planes[j], c.points[i]) == c.points[i]; }));
+	results.push_back(Run("ClosestPointLine", ops, [&](int i, int j) { return ClosestPoint(c.lines[j], c.points[i]) == c.points[i]; }));
+	results.push_back(Run("ClosestPointRay", ops, [&](int i, int j) { return ClosestPoint(c.rays[j], c.points[i]) == c.points[i]; }));
+	results.push_back(Run("ClosestPointTriangle", ops, [&](int i, int j) { return ClosestPoint(c.triangles[j], c.points[i]) == c.points[i]; }));
+	results.push_back(Run("ClosestPointCapsule", ops, [&](int i, int j) { return ClosestPoint(c.capsules[j], c.points[i]) == c.points[i]; }));
+
+	// Collision manifolds
+	results.push_back(Run("FindCollisionFeaturesSphereSphere", ops, [&](int i, int j) { return FindCollisionFeatures(c.spheres[i], c.spheres[j]).colliding; }));
+	results.push_back(Run("FindCollisionFeaturesOBBSphere", ops, [&](int i, int j) { return FindCollisionFeatures(c.obbs[i], c.spheres[j]).colliding; }));
+	results.push_back(Run("FindCollisionFeaturesOBBOBB", slowOps, [&](int i, int j) { return FindCollisionFeatures(c.obbs[i], c.obbs[j]).colliding; }));
+
+	// GJK against the hand written tests, then pairs only GJK handles
+	CollisionManifold manifold;
+	int firstSpecialised = results.size() - 3;
+	results.push_back(Run("GJKSphereSphere", ops, [&](int i, int j) { FindCollisionFeaturesGJK(c.spheres[i], c.spheres[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKOBBSphere", ops, [&](int i, int j) { FindCollisionFeaturesGJK(c.obbs[i], c.spheres[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKOBBOBB", slowOps, [&](int i, int j) { FindCollisionFeaturesGJK(c.obbs[i], c.obbs[j], &manifold); return manifold.colliding; }));
+	CompareDispatch("SphereSphere", results[firstSpecialised], results[firstSpecialised + 3]);
+	CompareDispatch("OBBSphere", results[firstSpecialised + 1], results[firstSpecialised + 4]);
+	CompareDispatch("OBBOBB", results[firstSpecialised + 2], results[firstSpecialised + 5]);
+	results.push_back(Run("GJKDistanceSphereSphere", ops, [&](int i, int j) { return GJKDistance(c.spheres[i], c.spheres[j], 0, 0) > 0.0f; }));
+	int firstCapsule = results.size();
+	results.push_back(Run("FindCollisionFeaturesCapsuleCapsule", ops, [&](int i, int j) { FindCollisionFeatures(c.capsules[i], c.capsules[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("FindCollisionFeaturesCapsuleSphere", ops, [&](int i, int j) { FindCollisionFeatures(c.capsules[i], c.spheres[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("FindCollisionFeaturesCapsuleOBB", ops, [&](int i, int j) { FindCollisionFeatures(c.capsules[i], c.obbs[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKCapsuleCapsule", ops, [&](int i, int j) { FindCollisionFeaturesGJK(c.capsules[i], c.capsules[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKCapsuleSphere", ops, [&](int i, int j) { FindCollisionFeaturesGJK(c.capsules[i], c.spheres[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKCapsuleOBB", ops, [&](int i, int j) { FindCollisionFeaturesGJK(c.capsules[i], c.obbs[j], &manifold); return manifold.colliding; }));
+	CompareDispatch("CapsuleCapsule", results[firstCapsule], results[firstCapsule + 3]);
+	CompareDispatch("CapsuleSphere", results[firstCapsule + 1], results[firstCapsule + 4]);
+	CompareDispatch("CapsuleOBB", results[firstCapsule + 2], results[firstCapsule + 5]);
+	results.push_back(Run("GJKHullHull", slowOps, [&](int i, int j) { FindCollisionFeaturesGJK(c.hulls[i], c.hulls[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKHullOBB", slowOps, [&](int i, int j) { FindCollisionFeaturesGJK(c.hulls[i], c.obbs[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("FindCollisionFeaturesHullOBB", slowOps, [&](int i, int j) { FindCollisionFeatures(ConvexShape(c.hulls[i]), ConvexShape(c.obbs[j]), &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKRoundHullOBB", slowOps, [&](int i, int j) { FindCollisionFeaturesGJK(c.roundHulls[i], c.obbs[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKRoundHullOBBScan", slowOps, [&](int i, int j) { FindCollisionFeaturesGJK(c.roundHullsScan[i], c.obbs[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("GJKIntersectRoundHullOBB", ops, [&](int i, int j) { return GJKIntersect(c.roundHulls[i], c.obbs[j]); }));
+	results.push_back(Run("GJKIntersectRoundHullOBBScan", ops, [&](int i, int j) { return GJKIntersect(c.roundHullsScan[i], c.obbs[j]); }));
+
+	// Shapes against static triangles
+	CollisionManifold meshManifolds[MESH_MAX_MANIFOLDS];
+	results.push_back(Run("FindCollisionFeaturesSphereTriangle", ops, [&](int i, int j) { FindCollisionFeatures(c.spheres[i], c.triangles[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("FindCollisionFeaturesOBBTriangle", ops, [&](int i, int j) { FindCollisionFeatures(c.obbs[i], c.triangles[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("FindCollisionFeaturesCapsuleTriangle", ops, [&](int i, int j) { FindCollisionFeatures(c.capsules[i], c.triangles[j], &manifold); return manifold.colliding; }));
+	results.push_back(Run("FindCollisionFeaturesMeshSphere", slowOps, [&](int i, int) { return FindCollisionFeatures(ConvexShape(c.spheres[i]), c.meshCollider, meshManifolds, MESH_MAX_MANIFOLDS) > 0; }));
+	results.push_back(Run("FindCollisionFeaturesMeshOBB", slowOps, [&](int i, int) { return FindCollisionFeatures(ConvexShape(c.obbs[i]), c.meshCollider, meshManifolds, MESH_MAX_MANIFOLDS) > 0; }));
+	results.push_back(Run("FindCollisionFeaturesMeshCapsule", slowOps, [&](int i, int) { return FindCollisionFeatures(ConvexShape(c.capsules[i]), c.meshCollider, meshManifolds, MESH_MAX_MANIFOLDS) > 0; }));
+
+	std::map<std::string, double> baseline;
+	if (baselinePath != 0) {
+		baseline = LoadBaseline(baselinePath);
+	}
+
+	printf("test,ops,ns_per_op,hit_rate%s\n", baselinePath != 0 ? ",baseline_ns_per_op,speedup" : "");
+	for (int i = 0, size = results.size(); i < size; ++i) {
+		const Result& r = results[i];
+		printf("%s,%d,%.2f,%.4f", r.name.c_str(), r.ops, r.nsPerOp, r.hitRate);
+		if (baselinePath != 0) {
+			std::map<std::string, double>::iterator it = baseline.find(r.name);
+			if (it != baseline.end()) {
+				printf(",%.2f,%.3f", it->second, it->second / r.nsPerOp);
+			}
+			else {
+				printf(",,");
+			}
+		}
+		printf("\n");
+	}
+
+	return 0;
+}
\ No newline at end of file
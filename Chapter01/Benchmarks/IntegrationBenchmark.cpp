@@ -0,0 +1,128 @@
+// Integration throughput of the per body virtual path against the
+// structure of arrays path in RigidbodyStorage.
+// Usage: IntegrationBenchmark [numBodies] [numSteps]
+// The storage row is what PhysicsSystem::Step pays per step: the
+// arrays are integrated, then every body gets it's new state and
+// collision volumes through Store. The storage_kernel row is
+// ApplyForces and Integrate alone.
+// Every third body is a hull with products of inertia, every body
+// has a torque, so the differences cover the full inertia tensor.
+
+#include "../Code/RigidbodyVolume.h"
+#include "../Code/RigidbodyStorage.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void CreateBodies(std::vector<RigidbodyVolume>& out, int numBodies, const HullMesh* hullMesh) {
+	out.resize(numBodies);
+	srand(1234);
+	for (int i = 0; i < numBodies; ++i) {
+		int type = (i % 3 == 0) ? RIGIDBODY_TYPE_BOX : (i % 3 == 1) ? RIGIDBODY_TYPE_SPHERE : RIGIDBODY_TYPE_HULL;
+		out[i] = RigidbodyVolume(type);
+		if (type == RIGIDBODY_TYPE_HULL) {
+			out[i].hullMesh = hullMesh;
+		}
+		out[i].position = vec3((float)(rand() % 1000), (float)(rand() % 1000), (float)(rand() % 1000));
+		out[i].velocity = vec3((float)(rand() % 20) - 10.0f, (float)(rand() % 20), (float)(rand() % 20) - 10.0f);
+#ifndef LINEAR_ONLY
+		out[i].angVel = vec3((float)(rand() % 10) * 0.1f, (float)(rand() % 10) * 0.1f, 0.0f);
+		out[i].torques = vec3((float)(rand() % 10) * 0.01f, (float)(rand() % 10) * 0.01f, (float)(rand() % 10) * 0.01f);
+#endif
+		out[i].mass = 1.0f + (float)(rand() % 10);
+		out[i].SynchCollisionVolumes();
+	}
+}
+
+int main(int argc, char** argv) {
+	int numBodies = (argc > 1) ? atoi(argv[1]) : 100000;
+	int numSteps = (argc > 2) ? atoi(argv[2]) : 100;
+	const float dt = 1.0f / 60.0f;
+
+	// A lopsided hull, so it's inertia tensor is not diagonal
+	Point points[] = {
+		Point(-0.5f, -0.2f, -0.3f), Point(0.9f, -0.2f, -0.3f), Point(-0.5f, 0.4f, -0.3f), Point(-0.5f, -0.2f, 0.6f),
+		Point(0.7f, 0.5f, 0.1f), Point(0.2f, 0.6f, 0.7f), Point(0.8f, -0.1f, 0.5f), Point(-0.3f, 0.5f, 0.4f)
+	};
+	HullMesh hullMesh;
+	BuildConvexHull(points, 8, &hullMesh, 16);
+
+	std::vector<RigidbodyVolume> scalar;
+	std::vector<RigidbodyVolume> packed;
+	std::vector<RigidbodyVolume> kernel;
+	CreateBodies(scalar, numBodies, &hullMesh);
+	CreateBodies(packed, numBodies, &hullMesh);
+	CreateBodies(kernel, numBodies, &hullMesh);
+
+	// Virtual dispatch through Rigidbody*, like PhysicsSystem does
+	std::vector<Rigidbody*> bodies;
+	for (int i = 0; i < numBodies; ++i) {
+		bodies.push_back(&scalar[i]);
+	}
+
+	Clock::time_point start = Clock::now();
+	for (int s = 0; s < numSteps; ++s) {
+		for (int i = 0; i < numBodies; ++i) {
+			bodies[i]->ApplyForces();
+		}
+		for (int i = 0; i < numBodies; ++i) {
+			bodies[i]->Update(dt);
+		}
+	}
+	double virtualTime = Seconds(start);
+
+	// Same as the integration of volumes in PhysicsSystem::Step
+	RigidbodyStorage storage;
+	for (int i = 0; i < numBodies; ++i) {
+		storage.AddBody(packed[i]);
+	}
+
+	start = Clock::now();
+	for (int s = 0; s < numSteps; ++s) {
+		storage.ApplyForces(0, numBodies);
+		storage.Integrate(dt, 0, numBodies);
+		for (int i = 0; i < numBodies; ++i) {
+			storage.Store(i, packed[i]);
+		}
+	}
+	double storageTime = Seconds(start);
+
+	RigidbodyStorage kernelStorage;
+	for (int i = 0; i < numBodies; ++i) {
+		kernelStorage.AddBody(kernel[i]);
+	}
+
+	start = Clock::now();
+	for (int s = 0; s < numSteps; ++s) {
+		kernelStorage.ApplyForces(0, numBodies);
+		kernelStorage.Integrate(dt, 0, numBodies);
+	}
+	double kernelTime = Seconds(start);
+
+	float maxError = 0.0f;
+	float maxRotError = 0.0f;
+	for (int i = 0; i < numBodies; ++i) {
+		vec3 diff = scalar[i].position - packed[i].position;
+		maxError = fmaxf(maxError, Magnitude(diff));
+		quat rotDiff = scalar[i].orientation + packed[i].orientation * -1.0f;
+		maxRotError = fmaxf(maxRotError, Magnitude(rotDiff));
+	}
+
+	double updates = (double)numBodies * (double)numSteps;
+	printf("path,bodies,steps,seconds,bodies_per_second\n");
+	printf("virtual,%d,%d,%f,%.0f\n", numBodies, numSteps, virtualTime, updates / virtualTime);
+	printf("storage,%d,%d,%f,%.0f\n", numBodies, numSteps, storageTime, updates / storageTime);
+	printf("storage_kernel,%d,%d,%f,%.0f\n", numBodies, numSteps, kernelTime, updates / kernelTime);
+	printf("# max position difference: %f\n", maxError);
+	printf("# max orientation difference: %f\n", maxRotError);
+
+	return 0;
+}
\ No newline at end of file
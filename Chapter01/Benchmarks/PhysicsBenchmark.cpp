@@ -0,0 +1,457 @@
+// Steps canned scenes through PhysicsSystem without a window or
+// OpenGL context, build with NO_RENDER (see Makefile).
+// Usage: PhysicsBenchmark [pyramid|spheres|capsules|hulls|mesh|bullets|speculative|cloth|particles|obstacles|all] [numSteps] [trace.json|-] [numWorkers]
+// If a trace file is given, tracing is enabled and every step is
+// written to it (see Tracer.h).
+// numWorkers is how many threads the job system starts, 0 (the
+// default) runs everything on the main thread (see JobSystem.h).
+// Phase columns are average milliseconds per step, they are only
+// printed if PhysicsSystem is built with PHYSICS_STATS. impacts is
+// how many times a continuous body was stopped over the whole run,
+// speculative_pairs the average separated pairs per step that got a
+// speculative contact.
+// Allocations per step are counted over the second half of the run,
+// after the scene has settled. The tagged memory of each scene is
+// written to stderr (see MemoryTracker.h).
+// Scenes with constraints run again without the constraint world, as
+// <scene>-no-constraint-world. Compare their constraints_ms and
+// cloths_ms.
+
+#include "../Code/PhysicsSystem.h"
+#include "../Code/JobSystem.h"
+#include "../Code/Tracer.h"
+#include "../Code/MemoryTracker.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Peak resident memory of the process so far, in kilobytes
+static long PeakMemoryKB() {
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return 0;
+#endif
+}
+
+static float Random(float min, float max) {
+	float random = ((float)rand()) / (float)RAND_MAX;
+	return (random * (max - min)) + min;
+}
+
+// Everything a scene owns, the physics system only keeps pointers
+typedef struct Scene {
+	PhysicsSystem physicsSystem;
+	std::vector<RigidbodyVolume> volumes;
+	std::vector<Particle> particles;
+	Cloth cloth;
+	HullMesh hullMesh; // Shared by all hull bodies
+	std::vector<Triangle> terrain;
+	Mesh terrainMesh;
+	Model terrainModel;
+	int numBodies;
+	int numConstraints;
+
+	inline Scene() : numBodies(0), numConstraints(0) { }
+
+	inline ~Scene() {
+		if (terrainMesh.accelerator != 0) {
+			FreeBVHNode(terrainMesh.accelerator);
+			delete terrainMesh.accelerator;
+		}
+	}
+} Scene;
+
+static void AddGround(Scene& scene) {
+	RigidbodyVolume ground(RIGIDBODY_TYPE_BOX);
+	ground.position = vec3(0.0f, -0.5f, 0.0f);
+	ground.box.size = vec3(50.0f, 0.5f, 50.0f);
+	ground.mass = 0.0f;
+	ground.SynchCollisionVolumes();
+	scene.volumes.push_back(ground);
+}
+
+static void AddConstraint(Scene& scene, const OBB& constraint) {
+	scene.physicsSystem.AddConstraint(constraint);
+	scene.numConstraints += 1;
+}
+
+static void AddVolumes(Scene& scene) {
+	for (int i = 0, size = scene.volumes.size(); i < size; ++i) {
+		scene.physicsSystem.AddRigidbody(&scene.volumes[i]);
+	}
+	scene.numBodies = scene.volumes.size();
+}
+
+static void CreatePyramid(Scene& scene) {
+	const int rows = 8;
+	AddGround(scene);
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < rows - y; ++x) {
+			RigidbodyVolume box(RIGIDBODY_TYPE_BOX);
+			box.box.size = vec3(0.5f, 0.5f, 0.5f);
+			box.position = vec3((float)x * 1.05f + (float)y * 0.525f, 0.5f + (float)y * 1.0f, 0.0f);
+			box.SynchCollisionVolumes();
+			scene.volumes.push_back(box);
+		}
+	}
+	AddVolumes(scene);
+	scene.physicsSystem.ImpulseIteration = 8;
+}
+
+static void CreateSphereRain(Scene& scene) {
+	const int count = 150;
+	AddGround(scene);
+	for (int i = 0; i < count; ++i) {
+		RigidbodyVolume sphere(RIGIDBODY_TYPE_SPHERE);
+		sphere.sphere.radius = 0.5f;
+		sphere.position = vec3(Random(-6.0f, 6.0f), Random(2.0f, 30.0f), Random(-6.0f, 6.0f));
+		sphere.SynchCollisionVolumes();
+		scene.volumes.push_back(sphere);
+	}
+	AddVolumes(scene);
+}
+
+// Same as the sphere rain, with capsules in random orientations
+static void CreateCapsuleRain(Scene& scene) {
+	const int count = 150;
+	AddGround(scene);
+	for (int i = 0; i < count; ++i) {
+		RigidbodyVolume capsule(RIGIDBODY_TYPE_CAPSULE);
+		capsule.capsule.radius = 0.3f;
+		capsule.capsule.halfHeight = 0.4f;
+		capsule.position = vec3(Random(-6.0f, 6.0f), Random(2.0f, 30.0f), Random(-6.0f, 6.0f));
+		capsule.orientation = QuatAxisAngle(Normalized(vec3(Random(-1.0f, 1.0f), 1.0f, Random(-1.0f, 1.0f))), Random(0.0f, 180.0f));
+		capsule.SynchCollisionVolumes();
+		scene.volumes.push_back(capsule);
+	}
+	AddVolumes(scene);
+}
+
+static void CreateClothDrape(Scene& scene) {
+	// Same setup as the chapter 16 demo, but a bigger cloth
+	const int clothSize = 30;
+	scene.cloth.Initialize(clothSize, 0.1f, vec3(0, 6, 0));
+	scene.cloth.SetStructuralSprings(-3.0f, 0.0f);
+	scene.cloth.SetBendSprings(-3.0f, 0.0f);
+	scene.cloth.SetShearSprings(-3.0f, 0.0f);
+	scene.physicsSystem.AddCloth(&scene.cloth);
+
+	OBB ground;
+	ground.size = vec3(10.0f, 0.1f, 10.0f);
+	AddConstraint(scene, ground);
+
+	float d = 0.5f;
+	vec3 posts[] = { vec3(d, 2.4f, d), vec3(-d, 2.3f, d), vec3(-d, 2.4f, -d), vec3(d, 2.3f, -d) };
+	for (int i = 0; i < 4; ++i) {
+		OBB post;
+		post.position = posts[i];
+		post.size = vec3(0.3f, 0.5f, 0.3f);
+		AddConstraint(scene, post);
+	}
+	scene.numBodies = clothSize * clothSize;
+}
+
+static void CreateParticleField(Scene& scene) {
+	const int count = 2000;
+	OBB ground;
+	ground.size = vec3(20.0f, 0.15f, 20.0f);
+	AddConstraint(scene, ground);
+
+	scene.particles.resize(count);
+	for (int i = 0; i < count; ++i) {
+		scene.particles[i].SetPosition(vec3(Random(-15.0f, 15.0f), Random(1.0f, 10.0f), Random(-15.0f, 15.0f)));
+		scene.particles[i].SetBounce(Random(0.0f, 1.0f));
+		scene.physicsSystem.AddRigidbody(&scene.particles[i]);
+	}
+	scene.numBodies = count;
+}
+
+// Same again with rocks, hulls of random points cut down to 16 vertices
+static void CreateHullRain(Scene& scene) {
+	const int count = 150;
+	std::vector<Point> points;
+	for (int i = 0; i < 64; ++i) {
+		points.push_back(vec3(Random(-0.6f, 0.6f), Random(-0.4f, 0.4f), Random(-0.5f, 0.5f)));
+	}
+	BuildConvexHull(&points[0], (int)points.size(), &scene.hullMesh, 16);
+
+	AddGround(scene);
+	for (int i = 0; i < count; ++i) {
+		RigidbodyVolume hull(RIGIDBODY_TYPE_HULL);
+		hull.hullMesh = &scene.hullMesh;
+		hull.position = vec3(Random(-6.0f, 6.0f), Random(2.0f, 30.0f), Random(-6.0f, 6.0f));
+		hull.orientation = QuatAxisAngle(Normalized(vec3(Random(-1.0f, 1.0f), 1.0f, Random(-1.0f, 1.0f))), Random(0.0f, 180.0f));
+		hull.SynchCollisionVolumes();
+		scene.volumes.push_back(hull);
+	}
+	AddVolumes(scene);
+}
+
+// Spheres, boxes and capsules falling on a wavy triangle mesh
+static void CreateMeshTerrain(Scene& scene) {
+	const int cells = 32;
+	const float cellSize = 1.0f;
+	float heights[cells + 1][cells + 1];
+	for (int x = 0; x <= cells; ++x) {
+		for (int z = 0; z <= cells; ++z) {
+			heights[x][z] = sinf((float)x * 0.4f) * cosf((float)z * 0.3f) * 1.5f;
+		}
+	}
+	for (int x = 0; x < cells; ++x) {
+		for (int z = 0; z < cells; ++z) {
+			float x0 = ((float)x - (float)cells * 0.5f) * cellSize;
+			float z0 = ((float)z - (float)cells * 0.5f) * cellSize;
+			Point a(x0, heights[x][z], z0);
+			Point b(x0 + cellSize, heights[x + 1][z], z0);
+			Point c(x0 + cellSize, heights[x + 1][z + 1], z0 + cellSize);
+			Point d(x0, heights[x][z + 1], z0 + cellSize);
+			scene.terrain.push_back(Triangle(a, b, c));
+			scene.terrain.push_back(Triangle(a, c, d));
+		}
+	}
+	scene.terrainMesh.numTriangles = (int)scene.terrain.size();
+	scene.terrainMesh.triangles = &scene.terrain[0];
+	scene.terrainModel.SetContent(&scene.terrainMesh);
+	scene.physicsSystem.AddMeshCollider(&scene.terrainModel);
+
+	const int count = 150;
+	for (int i = 0; i < count; ++i) {
+		vec3 position(Random(-12.0f, 12.0f), Random(3.0f, 30.0f), Random(-12.0f, 12.0f));
+		quat orientation = QuatAxisAngle(Normalized(vec3(Random(-1.0f, 1.0f), 1.0f, Random(-1.0f, 1.0f))), Random(0.0f, 180.0f));
+		RigidbodyVolume body(RIGIDBODY_TYPE_SPHERE);
+		if (i % 3 == 0) {
+			body.sphere.radius = 0.5f;
+		}
+		else if (i % 3 == 1) {
+			body.type = RIGIDBODY_TYPE_BOX;
+			body.box.size = vec3(0.4f, 0.4f, 0.4f);
+			body.orientation = orientation;
+		}
+		else {
+			body.type = RIGIDBODY_TYPE_CAPSULE;
+			body.capsule.radius = 0.3f;
+			body.capsule.halfHeight = 0.4f;
+			body.orientation = orientation;
+		}
+		body.position = position;
+		body.SynchCollisionVolumes();
+		scene.volumes.push_back(body);
+	}
+	AddVolumes(scene);
+}
+
+// Particles and a cloth falling through a field of 500 small boxes
+static void CreateObstacleField(Scene& scene) {
+	const int numBoxes = 500;
+	const int count = 2000;
+	OBB ground;
+	ground.size = vec3(20.0f, 0.15f, 20.0f);
+	AddConstraint(scene, ground);
+	for (int i = 1; i < numBoxes; ++i) {
+		OBB box;
+		box.position = vec3(Random(-15.0f, 15.0f), Random(0.5f, 4.0f), Random(-15.0f, 15.0f));
+		box.size = vec3(Random(0.2f, 0.6f), Random(0.1f, 0.3f), Random(0.2f, 0.6f));
+		box.orientation = Rotation3x3(0.0f, Random(0.0f, 90.0f), Random(0.0f, 30.0f));
+		AddConstraint(scene, box);
+	}
+
+	scene.particles.resize(count);
+	for (int i = 0; i < count; ++i) {
+		scene.particles[i].SetPosition(vec3(Random(-15.0f, 15.0f), Random(5.0f, 15.0f), Random(-15.0f, 15.0f)));
+		scene.particles[i].SetBounce(Random(0.0f, 1.0f));
+		scene.physicsSystem.AddRigidbody(&scene.particles[i]);
+	}
+
+	const int clothSize = 30;
+	scene.cloth.Initialize(clothSize, 0.2f, vec3(0, 6, 0));
+	scene.cloth.SetStructuralSprings(-3.0f, 0.0f);
+	scene.cloth.SetBendSprings(-3.0f, 0.0f);
+	scene.cloth.SetShearSprings(-3.0f, 0.0f);
+	scene.physicsSystem.AddCloth(&scene.cloth);
+	scene.numBodies = count + clothSize * clothSize;
+}
+
+// Small bodies fired at thin walls, a box and a mesh one. They are
+// either continuous or stopped by speculative contacts
+static void AddBullets(Scene& scene, bool continuous) {
+	const int count = 100;
+	AddGround(scene);
+	RigidbodyVolume wall(RIGIDBODY_TYPE_BOX);
+	wall.position = vec3(-3.0f, 2.0f, 0.0f);
+	wall.box.size = vec3(3.0f, 2.0f, 0.05f);
+	wall.mass = 0.0f;
+	wall.SynchCollisionVolumes();
+	scene.volumes.push_back(wall);
+
+	scene.terrain.push_back(Triangle(Point(0.0f, 0.0f, 0.0f), Point(6.0f, 0.0f, 0.0f), Point(6.0f, 4.0f, 0.0f)));
+	scene.terrain.push_back(Triangle(Point(0.0f, 0.0f, 0.0f), Point(6.0f, 4.0f, 0.0f), Point(0.0f, 4.0f, 0.0f)));
+	scene.terrainMesh.numTriangles = (int)scene.terrain.size();
+	scene.terrainMesh.triangles = &scene.terrain[0];
+	scene.terrainModel.SetContent(&scene.terrainMesh);
+	scene.physicsSystem.AddMeshCollider(&scene.terrainModel);
+
+	for (int i = 0; i < count; ++i) {
+		RigidbodyVolume bullet(RIGIDBODY_TYPE_SPHERE);
+		if (i % 2 == 1) {
+			bullet.type = RIGIDBODY_TYPE_BOX;
+		}
+		bullet.sphere.radius = 0.1f;
+		bullet.box.size = vec3(0.1f, 0.1f, 0.1f);
+		bullet.position = vec3(Random(-5.5f, 5.5f), Random(0.5f, 3.5f), Random(-60.0f, -5.0f));
+		bullet.velocity = vec3(0.0f, 0.0f, Random(100.0f, 400.0f));
+		bullet.continuous = continuous;
+		bullet.SynchCollisionVolumes();
+		scene.volumes.push_back(bullet);
+	}
+	AddVolumes(scene);
+	scene.physicsSystem.UseSpeculativeContacts = !continuous;
+}
+
+static void CreateBullets(Scene& scene) {
+	AddBullets(scene, true);
+}
+
+static void CreateSpeculativeBullets(Scene& scene) {
+	AddBullets(scene, false);
+}
+
+typedef void(*SceneFactory)(Scene&);
+
+// What a run had in it, to know which runs to compare it with
+typedef struct RunInfo {
+	int numConstraints;
+} RunInfo;
+
+static RunInfo RunScene(const char* name, SceneFactory factory, int numSteps, bool constraintWorld) {
+	TRACE_SCOPE(name);
+	const float dt = 1.0f / 60.0f;
+	srand(1234);
+
+	Scene* scene = new Scene();
+	factory(*scene);
+	scene->physicsSystem.UseConstraintWorld = constraintWorld;
+
+#ifdef PHYSICS_STATS
+	PhysicsStats sum;
+	ResetPhysicsStats(&sum);
+#endif
+
+	long long steadyAllocations = 0;
+	MemoryNewFrame();
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < numSteps; ++i) {
+		scene->physicsSystem.Update(dt);
+		MemoryNewFrame();
+		if (i >= numSteps / 2) {
+			for (int tag = 0; tag < MEMORY_TAG_COUNT; ++tag) {
+				steadyAllocations += GetMemoryStats(tag).frameAllocations;
+			}
+		}
+#ifdef PHYSICS_STATS
+		const PhysicsStats& stats = scene->physicsSystem.GetStats();
+		sum.findPairs += stats.findPairs;
+		sum.applyForces += stats.applyForces;
+		sum.impulses += stats.impulses;
+		sum.integration += stats.integration;
+		sum.linearProjection += stats.linearProjection;
+		sum.springs += stats.springs;
+		sum.cloths += stats.cloths;
+		sum.constraints += stats.constraints;
+		sum.sweeps += stats.sweeps;
+		sum.impacts += stats.impacts;
+		sum.speculativePairs += stats.speculativePairs;
+		sum.contacts += stats.contacts;
+#endif
+	}
+	double seconds = Seconds(start);
+
+	int steadySteps = numSteps - numSteps / 2;
+	printf("%s,%d,%d,%f,%.1f,%.4f,%ld,%.1f", name, scene->numBodies, numSteps,
+		seconds, (double)numSteps / seconds, seconds * 1000.0 / (double)numSteps, PeakMemoryKB(),
+		(steadySteps > 0) ? (double)steadyAllocations / (double)steadySteps : 0.0);
+#ifdef PHYSICS_STATS
+	float n = (float)numSteps;
+	printf(",%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.1f,%d,%.1f",
+		sum.findPairs / n, sum.applyForces / n, sum.impulses / n, sum.integration / n,
+		sum.linearProjection / n, sum.springs / n, sum.cloths / n, sum.constraints / n,
+		sum.sweeps / n, (float)sum.contacts / n, sum.impacts, (float)sum.speculativePairs / n);
+#endif
+	printf("\n");
+
+	std::cerr << "# " << name << "\n";
+	WriteMemoryReport(std::cerr);
+
+	RunInfo info;
+	info.numConstraints = scene->numConstraints;
+	delete scene;
+	return info;
+}
+
+int main(int argc, char** argv) {
+	const char* which = (argc > 1) ? argv[1] : "all";
+	int numSteps = (argc > 2) ? atoi(argv[2]) : 600;
+	const char* tracePath = (argc > 3 && strcmp(argv[3], "-") != 0) ? argv[3] : 0;
+	int numWorkers = (argc > 4) ? atoi(argv[4]) : 0;
+	StartJobSystem(numWorkers);
+	if (tracePath != 0) {
+		TraceThreadName("Main");
+		TraceEnable(true);
+	}
+
+	const char* names[] = { "pyramid", "spheres", "capsules", "hulls", "mesh", "bullets", "speculative", "cloth", "particles", "obstacles" };
+	SceneFactory factories[] = { CreatePyramid, CreateSphereRain, CreateCapsuleRain, CreateHullRain, CreateMeshTerrain, CreateBullets, CreateSpeculativeBullets, CreateClothDrape, CreateParticleField, CreateObstacleField };
+
+	// Peak memory is for the whole process, run one scene at a
+	// time to get the peak of that scene alone
+	printf("scene,bodies,steps,seconds,steps_per_second,ms_per_step,peak_memory_kb,allocations_per_step");
+#ifdef PHYSICS_STATS
+	printf(",find_pairs_ms,apply_forces_ms,impulses_ms,integration_ms,"
+		"linear_projection_ms,springs_ms,cloths_ms,constraints_ms,sweeps_ms,contacts,impacts,speculative_pairs");
+#endif
+	printf("\n");
+	bool found = false;
+	for (int i = 0; i < 10; ++i) {
+		if (strcmp(which, "all") == 0 || strcmp(which, names[i]) == 0) {
+			RunInfo info = RunScene(names[i], factories[i], numSteps, true);
+			if (info.numConstraints > 0) {
+				std::string linear = std::string(names[i]) + "-no-constraint-world";
+				RunScene(linear.c_str(), factories[i], numSteps, false);
+			}
+			found = true;
+		}
+	}
+
+	StopJobSystem();
+	if (!found) {
+		fprintf(stderr, "Unknown scene: %s\n", which);
+		return 1;
+	}
+	if (tracePath != 0 && !TraceWriteJSON(tracePath)) {
+		fprintf(stderr, "Could not write trace: %s\n", tracePath);
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
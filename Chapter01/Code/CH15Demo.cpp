@@ -28,6 +28,8 @@ void CH15Demo::Initialize(int width, int height) {
 }
 
 void CH15Demo::ResetDemo() {
+	// The bodies are being stepped if the physics thread runs
+	physicsSystem.LockThread();
 	physicsSystem.ClearRigidbodys();
 	physicsSystem.ClearConstraints();
 
@@ -37,7 +39,7 @@ void CH15Demo::ResetDemo() {
 	bodies[0].type = RIGIDBODY_TYPE_BOX;
 	bodies[0].position = vec3(0.5f, 6, 0);
 #ifndef LINEAR_ONLY
-	bodies[0].orientation = vec3(0.0f, 0.0f, 0.4f);
+	bodies[0].orientation = QuatAxisAngle(vec3(0.0f, 0.0f, 1.0f), RAD2DEG(0.4f));
 #endif
 
 	bodies[1].type = RIGIDBODY_TYPE_BOX;
@@ -55,6 +57,11 @@ void CH15Demo::ResetDemo() {
 		physicsSystem.AddRigidbody(&bodies[i]);
 	}
 	physicsSystem.AddRigidbody(&groundBox);
+	physicsSystem.UnlockThread();
+}
+
+void CH15Demo::Shutdown() {
+	physicsSystem.StopThread();
 }
 
 void CH15Demo::ImGUI() {
@@ -63,19 +70,31 @@ void CH15Demo::ImGUI() {
 	if (size_imgui_window) {
 		size_imgui_window = false;
 		ImGui::SetNextWindowPos(ImVec2(400, 10));
-		ImGui::SetNextWindowSize(ImVec2(370, 75));
+#ifdef PHYSICS_STATS
+		ImGui::SetNextWindowSize(ImVec2(370, 190));
+#else
+		ImGui::SetNextWindowSize(ImVec2(370, 100));
+#endif
 	}
 
 	ImGui::Begin("Chapter 15 Demo", 0, ImGuiWindowFlags_NoResize);
 
+	// Edited as copies, the physics thread only has to wait if
+	// something changed
+	float projection = physicsSystem.LinearProjectionPercent;
+	float slack = physicsSystem.PenetrationSlack;
+	int iterations = physicsSystem.ImpulseIteration;
+	bool doProjection = physicsSystem.DoLinearProjection;
+	bool changed = false;
+
 	ImGui::PushItemWidth(55);
-	ImGui::SliderFloat("Porjection", &physicsSystem.LinearProjectionPercent, 0.2f, 0.8f);
+	changed |= ImGui::SliderFloat("Porjection", &projection, 0.2f, 0.8f);
 	ImGui::SameLine();
 	ImGui::PushItemWidth(55);
-	ImGui::SliderFloat("Slop", &physicsSystem.PenetrationSlack, 0.01f, 0.1f);
+	changed |= ImGui::SliderFloat("Slop", &slack, 0.01f, 0.1f);
 	ImGui::SameLine();
 	ImGui::PushItemWidth(55);
-	ImGui::SliderInt("Iteration", &physicsSystem.ImpulseIteration, 1, 20);
+	changed |= ImGui::SliderInt("Iteration", &iterations, 1, 20);
 
 	if (ImGui::Button("Reset")) {
 		ResetDemo();
@@ -83,7 +102,44 @@ void CH15Demo::ImGUI() {
 	ImGui::SameLine();
 	ImGui::Checkbox("Debug Render", &physicsSystem.DebugRender);
 	ImGui::SameLine();
-	ImGui::Checkbox("Linear Projection", &physicsSystem.DoLinearProjection);
+	changed |= ImGui::Checkbox("Linear Projection", &doProjection);
+
+	if (changed) {
+		physicsSystem.LockThread();
+		physicsSystem.LinearProjectionPercent = projection;
+		physicsSystem.PenetrationSlack = slack;
+		physicsSystem.ImpulseIteration = iterations;
+		physicsSystem.DoLinearProjection = doProjection;
+		physicsSystem.UnlockThread();
+	}
+
+	bool threaded = physicsSystem.IsThreaded();
+	if (ImGui::Checkbox("Physics Thread", &threaded)) {
+		if (threaded) {
+			physicsSystem.StartThread();
+		}
+		else {
+			physicsSystem.StopThread();
+		}
+	}
+	ImGui::SameLine();
+	// Steps at 1/60 no matter how often Update runs, rendering blends
+	// the last two steps
+	bool fixedStep = physicsSystem.FixedTimeStep > 0.0f;
+	if (ImGui::Checkbox("Fixed Step", &fixedStep)) {
+		physicsSystem.LockThread();
+		physicsSystem.FixedTimeStep = fixedStep ? 1.0f / 60.0f : 0.0f;
+		physicsSystem.UnlockThread();
+	}
+
+#ifdef PHYSICS_STATS
+	const PhysicsStats& stats = physicsSystem.GetStats();
+	ImGui::Text("Step: %.3f ms, pairs: %.3f ms, impulses: %.3f ms", stats.total, stats.findPairs, stats.impulses);
+	ImGui::Text("Forces: %.3f ms, integrate: %.3f ms", stats.applyForces, stats.integration);
+	ImGui::Text("Projection: %.3f ms, constraints: %.3f ms", stats.linearProjection, stats.constraints);
+	ImGui::Text("Pairs: %d tested, %d colliding", stats.pairsTested, stats.pairsColliding);
+	ImGui::Text("Contacts: %d, impulses: %d, awake: %d", stats.contacts, stats.impulseApplications, stats.bodiesAwake);
+#endif
 
 	ImGui::End();
 }
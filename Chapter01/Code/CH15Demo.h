@@ -20,6 +20,7 @@ public:
 	void Render();
 	void Update(float dt);
 	void ImGUI();
+	void Shutdown();
 };
 
 
@@ -1,6 +1,43 @@
 #include "Cloth.h"
-#include "glad/glad.h"
-#include "FixedFunctionPrimitives.h"
+#include "JobSystem.h"
+#include "Tracer.h"
+
+// Particles per job, each particle only changes itself. Springs change
+// two particles, they are applied on the calling thread
+#define CLOTH_JOB_GRAIN 256
+
+typedef struct ClothJobData {
+	Particle* verts;
+	float dt;
+	const std::vector<OBB>* constraints;
+	const ConstraintWorld* world;
+} ClothJobData;
+
+static void ApplyForcesJob(void* data, int begin, int end) {
+	ClothJobData& job = *(ClothJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		job.verts[i].ApplyForces();
+	}
+}
+
+static void UpdateJob(void* data, int begin, int end) {
+	ClothJobData& job = *(ClothJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		job.verts[i].Update(job.dt);
+	}
+}
+
+static void SolveConstraintsJob(void* data, int begin, int end) {
+	ClothJobData& job = *(ClothJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		if (job.world != 0) {
+			job.verts[i].SolveConstraints(*job.world);
+		}
+		else {
+			job.verts[i].SolveConstraints(*job.constraints);
+		}
+	}
+}
 
 void Cloth::Initialize(int gridSize, float distance, const vec3& position) {
 	float k = -1.0f;
@@ -139,24 +176,43 @@ void Cloth::SetParticleMass(float mass) {
 }
 
 void Cloth::ApplyForces() {
-	for (int i = 0, size = verts.size(); i < size; ++i) {
-		verts[i].ApplyForces();
+	TRACE_SCOPE("Cloth::ApplyForces");
+	if (verts.empty()) {
+		return;
 	}
+	ClothJobData job = { &verts[0], 0.0f, 0, 0 };
+	ParallelFor((int)verts.size(), CLOTH_JOB_GRAIN, ApplyForcesJob, &job);
 }
 
 void Cloth::Update(float dt) {
-	for (int i = 0, size = verts.size(); i < size; ++i) {
-		verts[i].Update(dt);
+	TRACE_SCOPE("Cloth::Update");
+	if (verts.empty()) {
+		return;
 	}
+	ClothJobData job = { &verts[0], dt, 0, 0 };
+	ParallelFor((int)verts.size(), CLOTH_JOB_GRAIN, UpdateJob, &job);
 }
 
 void Cloth::SolveConstraints(const std::vector<OBB>& constraints) {
-	for (int i = 0, size = verts.size(); i < size; ++i) {
-		verts[i].SolveConstraints(constraints);
+	TRACE_SCOPE("Cloth::SolveConstraints");
+	if (verts.empty()) {
+		return;
+	}
+	ClothJobData job = { &verts[0], 0.0f, &constraints, 0 };
+	ParallelFor((int)verts.size(), CLOTH_JOB_GRAIN, SolveConstraintsJob, &job);
+}
+
+void Cloth::SolveConstraints(const ConstraintWorld& world) {
+	TRACE_SCOPE("Cloth::SolveConstraints");
+	if (verts.empty()) {
+		return;
 	}
+	ClothJobData job = { &verts[0], 0.0f, 0, &world };
+	ParallelFor((int)verts.size(), CLOTH_JOB_GRAIN, SolveConstraintsJob, &job);
 }
 
 void Cloth::ApplySpringForces(float dt) {
+	TRACE_SCOPE("Cloth::ApplySpringForces");
 	for (int i = 0, size = structural.size(); i < size; ++i) {
 		structural[i].ApplyForce(dt);
 	}
@@ -166,86 +222,4 @@ void Cloth::ApplySpringForces(float dt) {
 	for (int i = 0, size = bend.size(); i < size; ++i) {
 		bend[i].ApplyForce(dt);
 	}
-}
-
-void Cloth::Render(bool debug) {
-	static const float redDiffuse[]{ 200.0f / 255.0f, 0.0f, 0.0f, 0.0f };
-	static const float redAmbient[]{ 200.0f / 255.0f, 50.0f / 255.0f, 50.0f / 255.0f, 0.0f };
-	static const float zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-	glColor3f(redDiffuse[0], redDiffuse[1], redDiffuse[2]);
-	glLightfv(GL_LIGHT0, GL_AMBIENT, redAmbient);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, redDiffuse);
-	glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
-
-	if (debug) {
-		for (int i = 0, size = verts.size(); i < size; ++i) {
-			verts[i].Render();
-		}
-
-		GLboolean status;
-		glGetBooleanv(GL_LIGHTING, &status);
-		glDisable(GL_LIGHTING);
-		
-		glColor3f(1.0f, 0.0f, 1.0f);
-		for (int i = 0, size = structural.size(); i < size; ++i) {
-			if (structural[i].GetP1() == 0 || structural[i].GetP2() == 0) {
-				continue;
-			}
-
-			Line l(structural[i].GetP1()->GetPosition(), structural[i].GetP2()->GetPosition());
-			::Render(l);
-		}
-
-		glColor3f(1.0f, 1.0f, 0.0f);
-		for (int i = 0, size = shear.size(); i < size; ++i) {
-			if (shear[i].GetP1() == 0 || shear[i].GetP2() == 0) {
-				continue;
-			}
-
-			Line l(shear[i].GetP1()->GetPosition(), shear[i].GetP2()->GetPosition());
-			::Render(l);
-		}
-
-		glColor3f(0.0f, 1.0f, 1.0f);
-		for (int i = 0, size = bend.size(); i < size; ++i) {
-			if (bend[i].GetP1() == 0 || bend[i].GetP2() == 0) {
-				continue;
-			}
-
-			vec3 p1 = bend[i].GetP1()->GetPosition();
-			vec3 p2 = bend[i].GetP2()->GetPosition();
-
-			// Visualization
-			/*p1.y += 0.1f;
-			p2.y += 0.1f;
-			for (int j = i; j >= 0; --j) {
-				p1.y += 0.1f;
-				p2.y += 0.1f;
-			}*/
-
-			Line l(p1, p2);
-			::Render(l);
-		}
-
-		if (status) {
-			glEnable(GL_LIGHTING);
-		}
-	}
-	else {
-		for (int x = 0; x < clothSize - 1; ++x) {
-			for (int z = 0; z < clothSize - 1; ++z) {
-				int tl = z * clothSize + x;
-				int bl = (z + 1) * clothSize + x;
-				int tr = z * clothSize + (x + 1);
-				int br = (z + 1) * clothSize + (x + 1);
-
-				Triangle t1(verts[tl].GetPosition(), verts[br].GetPosition(), verts[bl].GetPosition());
-				Triangle t2(verts[tl].GetPosition(), verts[tr].GetPosition(), verts[br].GetPosition());
-
-				::Render(t1, true);
-				::Render(t2, true);
-			}
-		}
-	}
 }
\ No newline at end of file
@@ -4,13 +4,14 @@
 #include "Particle.h"
 #include "Spring.h"
 #include <vector>
+#include "MemoryTracker.h"
 
 class Cloth {
 protected:
-	std::vector<Particle> verts;
-	std::vector<Spring> structural;
-	std::vector<Spring> shear;
-	std::vector<Spring> bend;
+	std::vector<Particle, TaggedAllocator<Particle, MEMORY_TAG_CLOTH> > verts;
+	std::vector<Spring, TaggedAllocator<Spring, MEMORY_TAG_CLOTH> > structural;
+	std::vector<Spring, TaggedAllocator<Spring, MEMORY_TAG_CLOTH> > shear;
+	std::vector<Spring, TaggedAllocator<Spring, MEMORY_TAG_CLOTH> > bend;
 	float clothSize;
 public:
 	// Public API
@@ -25,8 +26,11 @@ public:
 	void ApplyForces();
 	void Update(float dt);
 	void SolveConstraints(const std::vector<OBB>& constraints);
+	void SolveConstraints(const ConstraintWorld& world);
 	void ApplySpringForces(float dt);
+#ifndef NO_RENDER
 	void Render(bool debug);
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -186,22 +186,22 @@ void CollisionFeature::Render() {
 
 	glColor3f(1.0f, 0.0f, 0.0f);
 	if (r1.colliding) {
-		for (int i = 0; i < r1.contacts.size(); ++i) {
+		for (int i = 0; i < r1.numContacts; ++i) {
 			::Render(r1.contacts[i]);
 		}
 	}
 	if (r2.colliding) {
-		for (int i = 0; i < r2.contacts.size(); ++i) {
+		for (int i = 0; i < r2.numContacts; ++i) {
 			::Render(r2.contacts[i]);
 		}
 	}
 	if (r3.colliding) {
-		for (int i = 0; i < r3.contacts.size(); ++i) {
+		for (int i = 0; i < r3.numContacts; ++i) {
 			::Render(r3.contacts[i]);
 		}
 	}
 	if (r4.colliding) {
-		for (int i = 0; i < r4.contacts.size(); ++i) {
+		for (int i = 0; i < r4.numContacts; ++i) {
 			::Render(r4.contacts[i]);
 		}
 	}
@@ -0,0 +1,133 @@
+#include "ConstraintWorld.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Half size of the world space box around an OBB
+static vec3 HalfExtents(const OBB& box) {
+	const float* o = box.orientation.asArray;
+	vec3 result;
+	for (int i = 0; i < 3; ++i) {
+		result[i] = box.size.x * fabsf(o[i]) + box.size.y * fabsf(o[3 + i]) + box.size.z * fabsf(o[6 + i]);
+	}
+	return result;
+}
+
+// Sorts boxes by their center along one axis
+typedef struct CenterLess {
+	const std::vector<OBB>* boxes;
+	int axis;
+
+	inline bool operator()(int a, int b) const {
+		return (*boxes)[a].position.asArray[axis] < (*boxes)[b].position.asArray[axis];
+	}
+} CenterLess;
+
+// Builds the node for leafBoxes[first] up to leafBoxes[first + count]
+static void BuildNode(ConstraintWorld* world, int node, int first, int count) {
+	vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	vec3 centerMin = min;
+	vec3 centerMax = max;
+	for (int i = first; i < first + count; ++i) {
+		const OBB& box = world->boxes[world->leafBoxes[i]];
+		vec3 extents = HalfExtents(box);
+		for (int j = 0; j < 3; ++j) {
+			min[j] = fminf(min[j], box.position.asArray[j] - extents[j]);
+			max[j] = fmaxf(max[j], box.position.asArray[j] + extents[j]);
+			centerMin[j] = fminf(centerMin[j], box.position.asArray[j]);
+			centerMax[j] = fmaxf(centerMax[j], box.position.asArray[j]);
+		}
+	}
+	world->nodes[node].min = min;
+	world->nodes[node].max = max;
+
+	if (count <= CONSTRAINT_LEAF_SIZE) {
+		world->nodes[node].first = first;
+		world->nodes[node].count = count;
+		return;
+	}
+
+	// Split at the median center along the longest axis
+	vec3 spread = centerMax - centerMin;
+	CenterLess less;
+	less.boxes = &world->boxes;
+	less.axis = (spread.x > spread.y && spread.x > spread.z) ? 0 : (spread.y > spread.z) ? 1 : 2;
+	int half = count / 2;
+	std::vector<int>::iterator begin = world->leafBoxes.begin() + first;
+	std::nth_element(begin, begin + half, begin + count, less);
+
+	int children = (int)world->nodes.size();
+	world->nodes.resize(children + 2);
+	world->nodes[node].first = children;
+	world->nodes[node].count = 0;
+	BuildNode(world, children, first, half);
+	BuildNode(world, children + 1, first + half, count - half);
+}
+
+void BuildConstraintWorld(const std::vector<OBB>& constraints, ConstraintWorld* outWorld) {
+	TRACE_SCOPE("BuildConstraintWorld");
+	outWorld->boxes = constraints;
+	outWorld->leafBoxes.resize(constraints.size());
+	for (int i = 0, size = constraints.size(); i < size; ++i) {
+		outWorld->leafBoxes[i] = i;
+	}
+	outWorld->nodes.clear();
+	if (constraints.empty()) {
+		return;
+	}
+
+	// A binary tree with n leaves has 2n - 1 nodes
+	outWorld->nodes.reserve(2 * (constraints.size() / CONSTRAINT_LEAF_SIZE + 1));
+	outWorld->nodes.resize(1);
+	BuildNode(outWorld, 0, 0, (int)constraints.size());
+}
+
+int QueryConstraintWorld(const ConstraintWorld& world, const Line& segment, int* outBoxes, int maxBoxes) {
+	if (world.nodes.empty()) {
+		return 0;
+	}
+
+	vec3 min(fminf(segment.start.x, segment.end.x), fminf(segment.start.y, segment.end.y), fminf(segment.start.z, segment.end.z));
+	vec3 max(fmaxf(segment.start.x, segment.end.x), fmaxf(segment.start.y, segment.end.y), fmaxf(segment.start.z, segment.end.z));
+
+	int numBoxes = 0;
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const ConstraintNode& node = world.nodes[stack[--stackSize]];
+		if (node.min.x > max.x || node.max.x < min.x ||
+			node.min.y > max.y || node.max.y < min.y ||
+			node.min.z > max.z || node.max.z < min.z) {
+			continue;
+		}
+
+		if (node.count == 0) {
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = node.first + 1;
+			continue;
+		}
+
+		for (int i = node.first; i < node.first + node.count; ++i) {
+			if (numBoxes < maxBoxes) {
+				outBoxes[numBoxes] = world.leafBoxes[i];
+			}
+			numBoxes += 1;
+		}
+	}
+
+	// Few boxes are found, an insertion sort is enough
+	int written = (numBoxes < maxBoxes) ? numBoxes : maxBoxes;
+	for (int i = 1; i < written; ++i) {
+		int box = outBoxes[i];
+		int j = i - 1;
+		for (; j >= 0 && outBoxes[j] > box; --j) {
+			outBoxes[j + 1] = outBoxes[j];
+		}
+		outBoxes[j + 1] = box;
+	}
+
+	return numBoxes;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef _H_CONSTRAINT_WORLD_
+#define _H_CONSTRAINT_WORLD_
+
+#include "Geometry3D.h"
+#include <vector>
+
+// The static boxes particles and cloths collide with (the constraints
+// of the physics system), with a bounding volume hierarchy over them.
+// It's built once, then every particle only tests the boxes whose
+// bounds overlap the segment it moved along this step, instead of
+// every box.
+
+// A particle that overlaps more boxes than this tests all of them
+#ifndef MAX_CONSTRAINT_CANDIDATES
+#define MAX_CONSTRAINT_CANDIDATES 64
+#endif
+
+// Leaves are split until they have at most this many boxes
+#define CONSTRAINT_LEAF_SIZE 4
+
+typedef struct ConstraintNode {
+	vec3 min;
+	vec3 max;
+	// Leaf if count is more than 0, the boxes are leafBoxes[first]
+	// up to leafBoxes[first + count]. Otherwise the children are
+	// nodes[first] and nodes[first + 1]
+	int first;
+	int count;
+} ConstraintNode;
+
+typedef struct ConstraintWorld {
+	std::vector<OBB> boxes; // In the order they were given
+	std::vector<int> leafBoxes; // Indices into boxes, grouped by leaf
+	std::vector<ConstraintNode> nodes; // nodes[0] is the root
+} ConstraintWorld;
+
+void BuildConstraintWorld(const std::vector<OBB>& constraints, ConstraintWorld* outWorld);
+
+// Indices of the boxes whose bounds overlap the bounds of the segment,
+// smallest first. At most maxBoxes are written, the return value is how
+// many there are in total. Solving them in order gives the same result
+// as testing every box in order.
+int QueryConstraintWorld(const ConstraintWorld& world, const Line& segment, int* outBoxes, int maxBoxes);
+
+#endif
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "SimpleSprings.h"
 #include "CH16Demo.h"
 #include "JointDemo.h"
+#include "JobSystem.h"
 
 #include <cstdlib>
 
@@ -18,6 +19,7 @@ static DemoWindow g_WindowInstance("Physics Sandbox", 800, 600);
 
 void DemoWindow::OnInitialize() {
 	GLWindow::OnInitialize();
+	StartJobSystem(GetDefaultJobWorkerCount());
 
 	m_prevMousePos = vec2(0, 0);
 	m_selectedDemo = -1;
@@ -173,6 +175,7 @@ void DemoWindow::OnFixedUpdate(float deltaTime) {
 void DemoWindow::OnShutdown() {
 	GLWindow::OnShutdown();
 	StopDemo();
+	StopJobSystem();
 }
 
 void DemoWindow::StopDemo() {
@@ -8,10 +8,16 @@ protected:
 	Particle* p1;
 	Particle* p2;
 	float length;
+
+	// Moves both particles so they are length apart again
+	void SolveLength();
 public:
 	void Initialize(Particle* _p1, Particle* _p2, float len);
 	void SolveConstraints(const std::vector<OBB>& constraints);
+	void SolveConstraints(const ConstraintWorld& world);
+#ifndef NO_RENDER
 	void Render();
+#endif
 };
 
 #endif
@@ -45,7 +45,7 @@ void Render(const CollisionManifold& manifold) {
 
 	glColor3f(1.0f, 0.0f, 0.0f);
 	glBegin(GL_POINTS);
-	for (int i = 0; i < manifold.contacts.size(); ++i) {
+	for (int i = 0; i < manifold.numContacts; ++i) {
 		glVertex3f(manifold.contacts[i].x, manifold.contacts[i].y, manifold.contacts[i].z);
 	}
 	glEnd();
@@ -53,9 +53,9 @@ void Render(const CollisionManifold& manifold) {
 	glColor3f(0.0f, 1.0f, 0.0f);
 	glBegin(GL_LINES);
 	vec3 center = vec3();
-	for (int i = 0; i < manifold.contacts.size(); ++i) {
+	for (int i = 0; i < manifold.numContacts; ++i) {
 		vec3 start = manifold.contacts[i];
-		vec3 end = start + manifold.normal * manifold.depth;
+		vec3 end = start + manifold.normal * manifold.depths[i];
 		center = center + start;
 
 		glVertex3fv(start.asArray);
@@ -63,10 +63,10 @@ void Render(const CollisionManifold& manifold) {
 	}
 	glEnd();
 
-	if (manifold.contacts.size() == 0) {
+	if (manifold.numContacts == 0) {
 		return;
 	}
-	float denom = 1.0f / (float)manifold.contacts.size();
+	float denom = 1.0f / (float)manifold.numContacts;
 	center = center * denom;
 
 	glColor3f(0.0f, 0.0f, 1.0f);
@@ -349,6 +349,24 @@ void Render(const OBB& obb) {
 	glPopMatrix();
 }
 
+void Render(const Capsule& capsule) {
+	glPushMatrix();
+
+	mat4 rotation = FromMat3(capsule.orientation);
+	mat4 translation = Translation(capsule.position);
+	mat4 transform = rotation * translation;
+	glMultMatrixf(transform.asArray);
+
+	// The cylinder is along Y, same as the capsule
+	FixedFunctionCylinder(12, capsule.halfHeight * 2.0f, capsule.radius);
+	glTranslatef(0.0f, capsule.halfHeight, 0.0f);
+	FixedFunctionSphere(2, capsule.radius);
+	glTranslatef(0.0f, -2.0f * capsule.halfHeight, 0.0f);
+	FixedFunctionSphere(2, capsule.radius);
+
+	glPopMatrix();
+}
+
 void Render(const AABB& aabb) {
 	glPushMatrix();
 
@@ -22,6 +22,7 @@ void Render(const Sphere& sphere);
 void Render(const AABB& aabb);
 void RenderWithQuads(const AABB& aabb);
 void Render(const OBB& obb);
+void Render(const Capsule& capsule);
 void Render(const Plane& plane);
 void Render(const Plane& plane, float scale);
 void Render(const Triangle& triangle);
@@ -0,0 +1,797 @@
+#include "GJK.h"
+#include <cfloat>
+#include <cmath>
+
+#define GJK_MAX_ITERATIONS 64
+// Squared distance below which the shapes are touching
+#define GJK_EPSILON 0.000001f
+// Stop once a step gets less than this much closer (relative)
+#define GJK_TOLERANCE 0.0001f
+
+#define EPA_MAX_ITERATIONS 64
+#define EPA_MAX_VERTICES (EPA_MAX_ITERATIONS + 4)
+#define EPA_MAX_FACES (EPA_MAX_VERTICES * 2)
+#define EPA_TOLERANCE 0.001f
+
+Point Support(const Sphere& sphere, const vec3& dir) {
+	float lengthSq = MagnitudeSq(dir);
+	if (lengthSq < 1e-12f) {
+		return sphere.position;
+	}
+	return sphere.position + dir * (sphere.radius / sqrtf(lengthSq));
+}
+
+Point Support(const OBB& obb, const vec3& dir) {
+	Point result = obb.position;
+	const float* o = obb.orientation.asArray;
+	const float* e = obb.size.asArray;
+
+	for (int i = 0; i < 3; ++i) {
+		vec3 axis(o[i * 3 + 0], o[i * 3 + 1], o[i * 3 + 2]);
+		result = result + axis * ((Dot(axis, dir) >= 0.0f) ? e[i] : -e[i]);
+	}
+
+	return result;
+}
+
+Point Support(const Capsule& capsule, const vec3& dir) {
+	const float* o = capsule.orientation.asArray;
+	vec3 up(o[3], o[4], o[5]);
+	float h = (Dot(up, dir) >= 0.0f) ? capsule.halfHeight : -capsule.halfHeight;
+
+	return Support(Sphere(capsule.position + up * h, capsule.radius), dir);
+}
+
+Point Support(const ConvexHull& hull, const vec3& dir) {
+	if (hull.numVertices == 0) {
+		return hull.position;
+	}
+
+	// Direction in the local space of the hull
+	const float* o = hull.orientation.asArray;
+	vec3 local(
+		o[0] * dir.x + o[1] * dir.y + o[2] * dir.z,
+		o[3] * dir.x + o[4] * dir.y + o[5] * dir.z,
+		o[6] * dir.x + o[7] * dir.y + o[8] * dir.z
+	);
+
+	int best = 0;
+	float bestDot = Dot(hull.vertices[0], local);
+	if (hull.adjacency != 0) {
+		// Hill climb, move to the best neighbour until none is better.
+		// On a convex hull the first local maximum is the global one
+		for (bool moved = true; moved; ) {
+			moved = false;
+			int current = best;
+			for (int i = hull.adjacencyStart[current]; i < hull.adjacencyStart[current + 1]; ++i) {
+				int next = hull.adjacency[i];
+				float d = Dot(hull.vertices[next], local);
+				if (d > bestDot) {
+					bestDot = d;
+					best = next;
+					moved = true;
+				}
+			}
+		}
+	}
+	else {
+		for (int i = 1; i < hull.numVertices; ++i) {
+			float d = Dot(hull.vertices[i], local);
+			if (d > bestDot) {
+				bestDot = d;
+				best = i;
+			}
+		}
+	}
+
+	return hull.position + MultiplyVector(hull.vertices[best], hull.orientation);
+}
+
+Point Support(const ConvexShape& shape, const vec3& dir) {
+	switch (shape.type) {
+	case SHAPE_TYPE_SPHERE:
+		return Support(*shape.sphere, dir);
+	case SHAPE_TYPE_OBB:
+		return Support(*shape.obb, dir);
+	case SHAPE_TYPE_CAPSULE:
+		return Support(*shape.capsule, dir);
+	case SHAPE_TYPE_HULL:
+		return Support(*shape.hull, dir);
+	}
+	return Point();
+}
+
+Point GetCenter(const ConvexShape& shape) {
+	switch (shape.type) {
+	case SHAPE_TYPE_SPHERE:
+		return shape.sphere->position;
+	case SHAPE_TYPE_OBB:
+		return shape.obb->position;
+	case SHAPE_TYPE_CAPSULE:
+		return shape.capsule->position;
+	case SHAPE_TYPE_HULL:
+		return shape.hull->position;
+	}
+	return Point();
+}
+
+// A point of the Minkowski difference A - B, and the points of A and
+// B it came from. Those give the closest points on both shapes.
+typedef struct SupportPoint {
+	vec3 point;
+	vec3 a;
+	vec3 b;
+} SupportPoint;
+
+typedef struct Simplex {
+	SupportPoint points[4];
+	float weights[4]; // Closest point to the origin, in barycentric coordinates
+	int size;
+} Simplex;
+
+static SupportPoint MinkowskiSupport(const ConvexShape& A, const ConvexShape& B, const vec3& dir) {
+	SupportPoint result;
+	result.a = Support(A, dir);
+	result.b = Support(B, dir * -1.0f);
+	result.point = result.a - result.b;
+	return result;
+}
+
+// The ClosestOn functions find the point of the simplex closest to the
+// origin, and reduce the simplex to the smallest part that contains it
+
+static vec3 ClosestOnSegment(Simplex* s) {
+	vec3 a = s->points[0].point;
+	vec3 ab = s->points[1].point - a;
+	float t = -Dot(a, ab);
+	float denom = Dot(ab, ab);
+
+	if (t <= 0.0f || denom < 1e-12f) {
+		s->size = 1;
+		s->weights[0] = 1.0f;
+		return a;
+	}
+	if (t >= denom) {
+		s->points[0] = s->points[1];
+		s->size = 1;
+		s->weights[0] = 1.0f;
+		return s->points[0].point;
+	}
+
+	t /= denom;
+	s->weights[0] = 1.0f - t;
+	s->weights[1] = t;
+	return a + ab * t;
+}
+
+// Real Time Collision Detection, 5.1.5
+static vec3 ClosestOnTriangle(Simplex* s) {
+	SupportPoint A = s->points[0], B = s->points[1], C = s->points[2];
+	vec3 a = A.point, b = B.point, c = C.point;
+	vec3 ab = b - a, ac = c - a;
+
+	vec3 ap = a * -1.0f;
+	float d1 = Dot(ab, ap);
+	float d2 = Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		s->size = 1;
+		s->weights[0] = 1.0f;
+		return a;
+	}
+
+	vec3 bp = b * -1.0f;
+	float d3 = Dot(ab, bp);
+	float d4 = Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		s->points[0] = B;
+		s->size = 1;
+		s->weights[0] = 1.0f;
+		return b;
+	}
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		float v = d1 / (d1 - d3);
+		s->size = 2;
+		s->weights[0] = 1.0f - v;
+		s->weights[1] = v;
+		return a + ab * v;
+	}
+
+	vec3 cp = c * -1.0f;
+	float d5 = Dot(ab, cp);
+	float d6 = Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		s->points[0] = C;
+		s->size = 1;
+		s->weights[0] = 1.0f;
+		return c;
+	}
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		float w = d2 / (d2 - d6);
+		s->points[1] = C;
+		s->size = 2;
+		s->weights[0] = 1.0f - w;
+		s->weights[1] = w;
+		return a + ac * w;
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		s->points[0] = B;
+		s->points[1] = C;
+		s->size = 2;
+		s->weights[0] = 1.0f - w;
+		s->weights[1] = w;
+		return b + (c - b) * w;
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	float v = vb * denom;
+	float w = vc * denom;
+	s->weights[0] = 1.0f - v - w;
+	s->weights[1] = v;
+	s->weights[2] = w;
+	return a + ab * v + ac * w;
+}
+
+// Is the origin on the other side of plane abc than d? Flat
+// tetrahedrons count as outside, so their faces still get tested
+static bool OriginOutside(const vec3& a, const vec3& b, const vec3& c, const vec3& d) {
+	vec3 n = Cross(b - a, c - a);
+	float signOrigin = Dot(a * -1.0f, n);
+	float signD = Dot(d - a, n);
+	if (signD * signD < 1e-12f) {
+		return true;
+	}
+	return signOrigin * signD < 0.0f;
+}
+
+static vec3 ClosestOnTetrahedron(Simplex* s) {
+	static const int faces[4][4] = { // Three corners, and the one opposite
+		{ 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 }
+	};
+
+	vec3 closest;
+	float bestSq = FLT_MAX;
+	Simplex best;
+	best.size = 0;
+
+	for (int i = 0; i < 4; ++i) {
+		const int* f = faces[i];
+		if (!OriginOutside(s->points[f[0]].point, s->points[f[1]].point, s->points[f[2]].point, s->points[f[3]].point)) {
+			continue;
+		}
+
+		Simplex triangle;
+		triangle.points[0] = s->points[f[0]];
+		triangle.points[1] = s->points[f[1]];
+		triangle.points[2] = s->points[f[2]];
+		triangle.size = 3;
+		vec3 point = ClosestOnTriangle(&triangle);
+		float distSq = MagnitudeSq(point);
+		if (distSq < bestSq) {
+			bestSq = distSq;
+			closest = point;
+			best = triangle;
+		}
+	}
+
+	if (best.size == 0) {
+		// Origin is inside, the simplex stays a tetrahedron
+		for (int i = 0; i < 4; ++i) {
+			s->weights[i] = 0.25f;
+		}
+		return vec3();
+	}
+
+	*s = best;
+	return closest;
+}
+
+static vec3 ClosestOnSimplex(Simplex* s) {
+	switch (s->size) {
+	case 1:
+		s->weights[0] = 1.0f;
+		return s->points[0].point;
+	case 2:
+		return ClosestOnSegment(s);
+	case 3:
+		return ClosestOnTriangle(s);
+	}
+	return ClosestOnTetrahedron(s);
+}
+
+// Returns true if the shapes touch or overlap. If they don't and
+// findDistance is set, the simplex holds the closest feature of the
+// Minkowski difference. Otherwise it stops at the first separating axis
+static bool RunGJK(const ConvexShape& A, const ConvexShape& B, Simplex* simplex, bool findDistance) {
+	vec3 dir = GetCenter(B) - GetCenter(A);
+	if (MagnitudeSq(dir) < 1e-12f) {
+		dir = vec3(1.0f, 0.0f, 0.0f);
+	}
+
+	simplex->points[0] = MinkowskiSupport(A, B, dir);
+	simplex->weights[0] = 1.0f;
+	simplex->size = 1;
+	vec3 v = simplex->points[0].point;
+
+	for (int i = 0; i < GJK_MAX_ITERATIONS; ++i) {
+		float vSq = MagnitudeSq(v);
+		if (vSq < GJK_EPSILON) {
+			return true;
+		}
+
+		SupportPoint w = MinkowskiSupport(A, B, v * -1.0f);
+		if (!findDistance && Dot(v, w.point) > 0.0f) {
+			return false; // w doesn't get past the origin, v separates
+		}
+		// Can't get any closer to the origin, v is the closest point
+		if (vSq - Dot(v, w.point) <= vSq * GJK_TOLERANCE) {
+			return false;
+		}
+		for (int j = 0; j < simplex->size; ++j) {
+			if (MagnitudeSq(simplex->points[j].point - w.point) < 1e-12f) {
+				return false; // Same point again, no progress
+			}
+		}
+
+		simplex->points[simplex->size++] = w;
+		v = ClosestOnSimplex(simplex);
+		if (simplex->size == 4) {
+			return true; // Origin is inside the tetrahedron
+		}
+	}
+
+	return MagnitudeSq(v) < GJK_EPSILON;
+}
+
+float GJKDistance(const ConvexShape& A, const ConvexShape& B, Point* outClosestA, Point* outClosestB) {
+	Simplex simplex;
+	if (RunGJK(A, B, &simplex, true)) {
+		return 0.0f;
+	}
+
+	vec3 a, b;
+	for (int i = 0; i < simplex.size; ++i) {
+		a = a + simplex.points[i].a * simplex.weights[i];
+		b = b + simplex.points[i].b * simplex.weights[i];
+	}
+	if (outClosestA != 0) {
+		*outClosestA = a;
+	}
+	if (outClosestB != 0) {
+		*outClosestB = b;
+	}
+	return Magnitude(a - b);
+}
+
+bool GJKIntersect(const ConvexShape& A, const ConvexShape& B) {
+	Simplex simplex;
+	return RunGJK(A, B, &simplex, false);
+}
+
+// A copy of a shape, so it can be moved without moving the original
+typedef struct MovedShape {
+	Sphere sphere;
+	OBB obb;
+	Capsule capsule;
+	ConvexHull hull;
+	ConvexShape shape;
+} MovedShape;
+
+static void CopyShape(const ConvexShape& shape, MovedShape* out) {
+	out->shape.type = shape.type;
+	if (shape.type == SHAPE_TYPE_SPHERE) {
+		out->sphere = *shape.sphere;
+		out->shape.sphere = &out->sphere;
+	}
+	else if (shape.type == SHAPE_TYPE_OBB) {
+		out->obb = *shape.obb;
+		out->shape.obb = &out->obb;
+	}
+	else if (shape.type == SHAPE_TYPE_CAPSULE) {
+		out->capsule = *shape.capsule;
+		out->shape.capsule = &out->capsule;
+	}
+	else {
+		out->hull = *shape.hull;
+		out->shape.hull = &out->hull;
+	}
+}
+
+static void SetPosition(MovedShape* moved, const Point& position) {
+	moved->sphere.position = position;
+	moved->obb.position = position;
+	moved->capsule.position = position;
+	moved->hull.position = position;
+}
+
+// Conservative advancement: the closest points give a plane between
+// the shapes, A can always move as far as that plane along the motion
+// without touching B. Repeat from there until the gap is closed.
+float TimeOfImpact(const ConvexShape& A, const vec3& motion, const ConvexShape& B, float tolerance, vec3* outNormal, Point* outPoint) {
+	MovedShape moved;
+	CopyShape(A, &moved);
+	Point start = GetCenter(A);
+
+	float t = 0.0f;
+	float lastT = 0.0f;
+	Point a, b;
+	vec3 normal = Normalized(motion);
+	for (int i = 0; i < GJK_MAX_ITERATIONS; ++i) {
+		SetPosition(&moved, start + motion * t);
+		float distance = GJKDistance(moved.shape, B, &a, &b);
+		if (distance <= tolerance) {
+			if (i == 0) {
+				return 1.0f; // Already touching, not an impact
+			}
+			if (distance > 0.0f) {
+				normal = (b - a) * (1.0f / distance);
+			}
+			else {
+				// Too close for GJK to find the closest points, use
+				// the ones of the last iteration moved along
+				a = a + motion * (t - lastT);
+			}
+			if (outNormal != 0) {
+				*outNormal = normal;
+			}
+			if (outPoint != 0) {
+				*outPoint = (a + b) * 0.5f;
+			}
+			return t;
+		}
+		normal = (b - a) * (1.0f / distance);
+		lastT = t;
+
+		// How fast the motion closes the gap
+		float closing = Dot(motion, b - a) / distance;
+		if (closing <= 0.0f) {
+			return 1.0f; // Moving away
+		}
+		t += (distance - tolerance * 0.5f) / closing;
+		if (t >= 1.0f) {
+			return 1.0f;
+		}
+	}
+	return 1.0f;
+}
+
+// GJK can stop with less than 4 points when the shapes just touch.
+// EPA needs a tetrahedron, so search for the missing points.
+static bool CompleteTetrahedron(const ConvexShape& A, const ConvexShape& B, Simplex* s) {
+	static const vec3 axis[] = {
+		vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0),
+		vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+	};
+
+	if (s->size == 1) {
+		for (int i = 0; i < 6; ++i) {
+			SupportPoint w = MinkowskiSupport(A, B, axis[i]);
+			if (MagnitudeSq(w.point - s->points[0].point) > 1e-8f) {
+				s->points[s->size++] = w;
+				break;
+			}
+		}
+	}
+
+	if (s->size == 2) {
+		vec3 line = s->points[1].point - s->points[0].point;
+		// Any direction perpendicular to the line, then rotate around it
+		vec3 perpendicular = Cross(line, (fabsf(line.x) < 0.57735f) ? axis[0] : axis[2]);
+		vec3 search[] = { perpendicular, perpendicular * -1.0f, Cross(line, perpendicular), Cross(perpendicular, line) };
+		for (int i = 0; i < 4; ++i) {
+			SupportPoint w = MinkowskiSupport(A, B, search[i]);
+			if (MagnitudeSq(Cross(w.point - s->points[0].point, line)) > 1e-8f) {
+				s->points[s->size++] = w;
+				break;
+			}
+		}
+	}
+
+	if (s->size == 3) {
+		vec3 normal = Cross(s->points[1].point - s->points[0].point, s->points[2].point - s->points[0].point);
+		vec3 search[] = { normal, normal * -1.0f };
+		for (int i = 0; i < 2; ++i) {
+			SupportPoint w = MinkowskiSupport(A, B, search[i]);
+			if (fabsf(Dot(w.point - s->points[0].point, normal)) > 1e-8f) {
+				s->points[s->size++] = w;
+				break;
+			}
+		}
+	}
+
+	return s->size == 4;
+}
+
+typedef struct EPAFace {
+	int v[3];
+	vec3 normal; // Points away from the inside of the polytope
+	float distance; // From the origin
+} EPAFace;
+
+typedef struct EPAPolytope {
+	SupportPoint vertices[EPA_MAX_VERTICES];
+	EPAFace faces[EPA_MAX_FACES];
+	int numVertices;
+	int numFaces;
+	vec3 inside; // Stays inside, as the polytope only grows
+} EPAPolytope;
+
+static bool AddFace(EPAPolytope* p, int a, int b, int c) {
+	if (p->numFaces >= EPA_MAX_FACES) {
+		return false;
+	}
+
+	vec3 va = p->vertices[a].point;
+	vec3 normal = Cross(p->vertices[b].point - va, p->vertices[c].point - va);
+	if (MagnitudeSq(normal) < 1e-12f) {
+		normal = va - p->inside; // Sliver, any outward direction works
+	}
+	Normalize(normal);
+
+	EPAFace& face = p->faces[p->numFaces++];
+	face.v[0] = a;
+	face.v[1] = b;
+	face.v[2] = c;
+	if (Dot(normal, va - p->inside) < 0.0f) {
+		face.v[1] = c; // Wind the face so the normal points out
+		face.v[2] = b;
+		normal = normal * -1.0f;
+	}
+	face.normal = normal;
+	face.distance = Dot(normal, va);
+	return true;
+}
+
+// Adds an edge of a removed face to the horizon. Edges shared by
+// two removed faces show up twice (once in each direction), those
+// are inside the hole and are dropped.
+static void AddHorizonEdge(int edges[][2], int* numEdges, int a, int b) {
+	for (int i = 0; i < *numEdges; ++i) {
+		if (edges[i][0] == b && edges[i][1] == a) {
+			*numEdges -= 1;
+			edges[i][0] = edges[*numEdges][0];
+			edges[i][1] = edges[*numEdges][1];
+			return;
+		}
+	}
+	edges[*numEdges][0] = a;
+	edges[*numEdges][1] = b;
+	*numEdges += 1;
+}
+
+// Expands the tetrahedron GJK ended with, until the face closest to
+// the origin is on the surface of the Minkowski difference. That face
+// gives the normal, depth, and (through barycentric coordinates) the
+// deepest points of both shapes.
+static bool RunEPA(const ConvexShape& A, const ConvexShape& B, const Simplex& simplex, CollisionManifold* result) {
+	EPAPolytope p;
+	p.numVertices = 4;
+	p.numFaces = 0;
+	p.inside = vec3();
+	for (int i = 0; i < 4; ++i) {
+		p.vertices[i] = simplex.points[i];
+		p.inside = p.inside + simplex.points[i].point * 0.25f;
+	}
+	AddFace(&p, 0, 1, 2);
+	AddFace(&p, 0, 3, 1);
+	AddFace(&p, 0, 2, 3);
+	AddFace(&p, 1, 3, 2);
+
+	int edges[EPA_MAX_FACES * 3][2];
+	int closest = 0;
+	for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; ++iteration) {
+		closest = 0;
+		for (int i = 1; i < p.numFaces; ++i) {
+			if (p.faces[i].distance < p.faces[closest].distance) {
+				closest = i;
+			}
+		}
+
+		EPAFace face = p.faces[closest];
+		SupportPoint w = MinkowskiSupport(A, B, face.normal);
+		if (Dot(w.point, face.normal) - face.distance < EPA_TOLERANCE || p.numVertices >= EPA_MAX_VERTICES) {
+			break; // The face is on the surface
+		}
+
+		int index = p.numVertices++;
+		p.vertices[index] = w;
+
+		// Remove every face that can see the new point
+		int numEdges = 0;
+		for (int i = p.numFaces - 1; i >= 0; --i) {
+			EPAFace& f = p.faces[i];
+			if (Dot(f.normal, w.point - p.vertices[f.v[0]].point) > 0.0f) {
+				AddHorizonEdge(edges, &numEdges, f.v[0], f.v[1]);
+				AddHorizonEdge(edges, &numEdges, f.v[1], f.v[2]);
+				AddHorizonEdge(edges, &numEdges, f.v[2], f.v[0]);
+				p.faces[i] = p.faces[--p.numFaces];
+			}
+		}
+
+		// And close the hole with faces to the new point
+		for (int i = 0; i < numEdges; ++i) {
+			if (!AddFace(&p, edges[i][0], edges[i][1], index)) {
+				break;
+			}
+		}
+		if (p.numFaces == 0) {
+			return false;
+		}
+		closest = 0;
+	}
+
+	for (int i = 1; i < p.numFaces; ++i) {
+		if (p.faces[i].distance < p.faces[closest].distance) {
+			closest = i;
+		}
+	}
+	const EPAFace& face = p.faces[closest];
+	const SupportPoint& a = p.vertices[face.v[0]];
+	const SupportPoint& b = p.vertices[face.v[1]];
+	const SupportPoint& c = p.vertices[face.v[2]];
+
+	// Barycentric coordinates of the origin, projected onto the face
+	vec3 point = face.normal * face.distance;
+	vec3 v0 = b.point - a.point, v1 = c.point - a.point, v2 = point - a.point;
+	float d00 = Dot(v0, v0), d01 = Dot(v0, v1), d11 = Dot(v1, v1);
+	float d20 = Dot(v2, v0), d21 = Dot(v2, v1);
+	float denom = d00 * d11 - d01 * d01;
+	float u = 1.0f, v = 0.0f, t = 0.0f;
+	if (fabsf(denom) > 1e-12f) {
+		v = (d11 * d20 - d01 * d21) / denom;
+		t = (d00 * d21 - d01 * d20) / denom;
+		u = 1.0f - v - t;
+	}
+
+	vec3 onA = a.a * u + b.a * v + c.a * t;
+	vec3 onB = a.b * u + b.b * v + c.b * t;
+
+	result->colliding = true;
+	result->normal = face.normal;
+	result->depth = (face.distance > 0.0f) ? face.distance : 0.0f;
+	result->contacts[0] = (onA + onB) * 0.5f;
+	result->depths[0] = result->depth;
+	result->numContacts = 1;
+	return true;
+}
+
+void FindCollisionFeaturesGJK(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	Simplex simplex;
+	if (!RunGJK(A, B, &simplex, false)) {
+		return;
+	}
+	if (!CompleteTetrahedron(A, B, &simplex)) {
+		return; // Both shapes are flat
+	}
+	RunEPA(A, B, simplex, result);
+}
+
+// Hand written tests, wrapped to fit the table
+
+static void SphereSphereFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	FindCollisionFeatures(*A.sphere, *B.sphere, result);
+}
+
+static void OBBSphereFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	FindCollisionFeatures(*A.obb, *B.sphere, result);
+}
+
+static void OBBOBBFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	FindCollisionFeatures(*A.obb, *B.obb, result);
+}
+
+static void CapsuleSphereFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	FindCollisionFeatures(*A.capsule, *B.sphere, result);
+}
+
+static void CapsuleCapsuleFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	FindCollisionFeatures(*A.capsule, *B.capsule, result);
+}
+
+static void CapsuleOBBFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	FindCollisionFeatures(*A.capsule, *B.obb, result);
+}
+
+// EPA finds a single contact, that's not enough for a hull to rest on
+// something. Every vertex of one shape that is inside of the other
+// becomes a contact, ReduceContacts keeps the 4 that span the most area
+#define MAX_HULL_CONTACTS 64
+
+static bool PointInShape(const Point& point, const ConvexShape& shape) {
+	if (shape.type == SHAPE_TYPE_OBB) {
+		return PointInOBB(point, *shape.obb);
+	}
+	Sphere sphere(point, 0.0f);
+	return GJKIntersect(ConvexShape(sphere), shape);
+}
+
+// Adds the vertices of hull that are inside of other, deeper than
+// the point of other furthest along dir. dir points away from other
+static void AddHullVertices(const ConvexHull& hull, const ConvexShape& other, const vec3& dir, Point* points, float* depths, int* numPoints) {
+	float face = Dot(dir, Support(other, dir));
+	for (int i = 0; i < hull.numVertices && *numPoints < MAX_HULL_CONTACTS; ++i) {
+		Point vertex = hull.position + MultiplyVector(hull.vertices[i], hull.orientation);
+		float depth = face - Dot(dir, vertex);
+		if (depth > 0.0f && PointInShape(vertex, other)) {
+			points[*numPoints] = vertex + dir * (depth * 0.5f);
+			depths[*numPoints] = depth;
+			*numPoints += 1;
+		}
+	}
+}
+
+static void HullFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	FindCollisionFeaturesGJK(A, B, result);
+	if (!result->colliding) {
+		return;
+	}
+
+	vec3 normal = result->normal;
+	Point points[MAX_HULL_CONTACTS];
+	float depths[MAX_HULL_CONTACTS];
+	int numPoints = 0;
+	AddHullVertices(*A.hull, B, normal * -1.0f, points, depths, &numPoints);
+	if (B.type == SHAPE_TYPE_HULL) {
+		AddHullVertices(*B.hull, A, normal, points, depths, &numPoints);
+	}
+
+	if (numPoints > 1) {
+		ReduceContacts(result, normal, points, depths, numPoints);
+	}
+}
+
+typedef struct CollisionEntry {
+	CollisionFunction function;
+	bool swap; // Call with B, A and flip the normal
+} CollisionEntry;
+
+static CollisionEntry collisionTable[SHAPE_TYPE_COUNT][SHAPE_TYPE_COUNT] = {
+	{ // Sphere
+		{ SphereSphereFeatures, false }, { OBBSphereFeatures, true },
+		{ CapsuleSphereFeatures, true }, { FindCollisionFeaturesGJK, false }
+	},
+	{ // OBB
+		{ OBBSphereFeatures, false }, { OBBOBBFeatures, false },
+		{ CapsuleOBBFeatures, true }, { HullFeatures, true }
+	},
+	{ // Capsule
+		{ CapsuleSphereFeatures, false }, { CapsuleOBBFeatures, false },
+		{ CapsuleCapsuleFeatures, false }, { HullFeatures, true }
+	},
+	{ // Hull
+		{ FindCollisionFeaturesGJK, false }, { HullFeatures, false },
+		{ HullFeatures, false }, { HullFeatures, false }
+	}
+};
+
+void FindCollisionFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result) {
+	const CollisionEntry& entry = collisionTable[A.type][B.type];
+	if (entry.swap) {
+		entry.function(B, A, result);
+		result->normal = result->normal * -1.0f;
+	}
+	else {
+		entry.function(A, B, result);
+	}
+}
+
+void SetCollisionFunction(int typeA, int typeB, CollisionFunction function) {
+	collisionTable[typeA][typeB].function = function;
+	collisionTable[typeA][typeB].swap = false;
+	if (typeA != typeB) {
+		collisionTable[typeB][typeA].function = function;
+		collisionTable[typeB][typeA].swap = true;
+	}
+}
+
+CollisionFunction GetCollisionFunction(int typeA, int typeB) {
+	return collisionTable[typeA][typeB].function;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef _H_GJK_
+#define _H_GJK_
+
+#include "Geometry3D.h"
+
+// Collision between any two convex shapes. GJK finds the distance
+// between the shapes (or that they overlap) using only their support
+// functions, EPA then finds how deep overlapping shapes penetrate.
+// A new shape only needs a support function to collide with all the
+// others. The dispatch table still uses the hand written tests where
+// they exist, they are faster (see GeometryBenchmark).
+
+#define SHAPE_TYPE_SPHERE	0
+#define SHAPE_TYPE_OBB		1
+#define SHAPE_TYPE_CAPSULE	2
+#define SHAPE_TYPE_HULL		3
+#define SHAPE_TYPE_COUNT	4
+
+// Points at one of the shapes above, it does not copy the shape
+typedef struct ConvexShape {
+	int type;
+	union {
+		const Sphere* sphere;
+		const OBB* obb;
+		const Capsule* capsule;
+		const ConvexHull* hull;
+	};
+
+	inline ConvexShape() : type(SHAPE_TYPE_SPHERE), sphere(0) { }
+	inline ConvexShape(const Sphere& s) : type(SHAPE_TYPE_SPHERE), sphere(&s) { }
+	inline ConvexShape(const OBB& o) : type(SHAPE_TYPE_OBB), obb(&o) { }
+	inline ConvexShape(const Capsule& c) : type(SHAPE_TYPE_CAPSULE), capsule(&c) { }
+	inline ConvexShape(const ConvexHull& h) : type(SHAPE_TYPE_HULL), hull(&h) { }
+} ConvexShape;
+
+// The point of the shape furthest along dir, dir doesn't need to be normalized
+Point Support(const Sphere& sphere, const vec3& dir);
+Point Support(const OBB& obb, const vec3& dir);
+Point Support(const Capsule& capsule, const vec3& dir);
+Point Support(const ConvexHull& hull, const vec3& dir);
+Point Support(const ConvexShape& shape, const vec3& dir);
+Point GetCenter(const ConvexShape& shape);
+
+// Distance between the shapes, 0 if they touch or overlap. The
+// closest points are only written if the shapes don't overlap
+float GJKDistance(const ConvexShape& A, const ConvexShape& B, Point* outClosestA, Point* outClosestB);
+bool GJKIntersect(const ConvexShape& A, const ConvexShape& B);
+// How far A gets along motion before it's within tolerance of B, as a
+// fraction of motion. 1 if it never gets there, or if it already was
+// at the start. Only A moves, B stays where it is and neither rotates.
+// On an impact outNormal points from A to B, outPoint is halfway
+// between the closest points.
+float TimeOfImpact(const ConvexShape& A, const vec3& motion, const ConvexShape& B, float tolerance, vec3* outNormal, Point* outPoint);
+// GJK, then EPA if the shapes overlap. Finds a single contact point,
+// halfway between the deepest points of both shapes. The dispatch
+// table adds more for hulls: every hull vertex inside the other shape
+void FindCollisionFeaturesGJK(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result);
+
+// Normal of the result points from A to B
+typedef void(*CollisionFunction)(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result);
+
+// Calls the function registered for the two shape types
+void FindCollisionFeatures(const ConvexShape& A, const ConvexShape& B, CollisionManifold* result);
+// Replaces the function for a pair of types. The reversed pair calls
+// it with the shapes swapped and flips the normal
+void SetCollisionFunction(int typeA, int typeB, CollisionFunction function);
+CollisionFunction GetCollisionFunction(int typeA, int typeB);
+
+#endif
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "Geometry3D.h"
+#include "JobSystem.h"
+#include "Tracer.h"
 #include <cmath>
 #include <cfloat>
 #include <list>
@@ -9,6 +11,8 @@
 
 #define CMP(x, y) \
 	(fabsf(x - y) <= FLT_EPSILON * fmaxf(1.0f, fmaxf(fabsf(x), fabsf(y))))
+#define CLAMP(x, low, high) \
+	fminf(fmaxf(x, low), high)
 
 float Length(const Line& line) {
 	return Magnitude(line.start - line.end);
@@ -315,6 +319,9 @@ Point ClosestPoint(const Point& point, const Line& line) {
 Point ClosestPoint(const Point& point, const Ray& ray) {
 	return ClosestPoint(ray, point);
 }
+Point ClosestPoint(const Point& point, const Capsule& capsule) {
+	return ClosestPoint(capsule, point);
+}
 Point ClosestPoint(const Point& p, const Triangle& t) {
 	return ClosestPoint(t, p);
 }
@@ -393,7 +400,7 @@ bool OverlapOnAxis(const AABB& aabb, const OBB& obb, const vec3& axis) {
 
 bool OverlapOnAxis(const OBB& obb1, const OBB& obb2, const vec3& axis) {
 	Interval a = GetInterval(obb1, axis);
-	Interval b = GetInterval(obb1, axis);
+	Interval b = GetInterval(obb2, axis);
 	return ((b.min <= a.max) && (a.min <= b.max));
 }
 
@@ -418,10 +425,12 @@ bool OverlapOnAxis(const Triangle& t1, const Triangle& t2, const vec3& axis) {
 Interval GetInterval(const Triangle& triangle, const vec3& axis) {
 	Interval result;
 
-	result.min = Dot(axis, triangle.points[0]);
+	Point points[] = { triangle.a, triangle.b, triangle.c };
+
+	result.min = Dot(axis, points[0]);
 	result.max = result.min;
 	for (int i = 1; i < 3; ++i) {
-		float value = Dot(axis, triangle.points[i]);
+		float value = Dot(axis, points[i]);
 		result.min = fminf(result.min, value);
 		result.max = fmaxf(result.max, value);
 	}
@@ -431,24 +440,7 @@ Interval GetInterval(const Triangle& triangle, const vec3& axis) {
 
 Interval GetInterval(const OBB& obb, const vec3& axis) {
 	vec3 vertex[8];
-
-	vec3 C = obb.position;	// OBB Center
-	vec3 E = obb.size;		// OBB Extents
-	const float* o = obb.orientation.asArray;
-	vec3 A[] = {			// OBB Axis
-		vec3(o[0], o[1], o[2]),
-		vec3(o[3], o[4], o[5]),
-		vec3(o[6], o[7], o[8]),
-	};
-
-	vertex[0] = C + A[0] * E[0] + A[1] * E[1] + A[2] * E[2];
-	vertex[1] = C - A[0] * E[0] + A[1] * E[1] + A[2] * E[2];
-	vertex[2] = C + A[0] * E[0] - A[1] * E[1] + A[2] * E[2];
-	vertex[3] = C + A[0] * E[0] + A[1] * E[1] - A[2] * E[2];
-	vertex[4] = C - A[0] * E[0] - A[1] * E[1] - A[2] * E[2];
-	vertex[5] = C + A[0] * E[0] - A[1] * E[1] - A[2] * E[2];
-	vertex[6] = C - A[0] * E[0] + A[1] * E[1] - A[2] * E[2];
-	vertex[7] = C - A[0] * E[0] - A[1] * E[1] + A[2] * E[2];
+	GetVertices(obb, vertex);
 
 	Interval result;
 	result.min = result.max = Dot(axis, vertex[0]);
@@ -501,30 +493,114 @@ bool AABBPlane(const AABB& aabb, const Plane& plane) {
 }
 
 bool OBBOBB(const OBB& obb1, const OBB& obb2) {
+	return OBBOBBPenetration(obb1, obb2, 0, 0);
+}
+
+// Overlap of two intervals with radius ra and rb whose centers are
+// distance apart. Like PenetrationDepth, if one interval is inside the
+// other this is the size of the smaller one
+static inline float OverlapDepth(float ra, float rb, float distance) {
+	float depth = ra + rb - fabsf(distance);
+	float smaller = 2.0f * fminf(ra, rb);
+	return (depth > smaller) ? smaller : depth;
+}
+
+// Gottschalk's separating axis test. Everything happens in the space
+// of obb1: R rotates the axis of obb2 into it and t is the offset of
+// obb2. Each of the 15 axis then only needs the projected radius of
+// both boxes, instead of projecting all 16 corners.
+bool OBBOBBPenetration(const OBB& obb1, const OBB& obb2, vec3* outNormal, float* outDepth) {
 	const float* o1 = obb1.orientation.asArray;
 	const float* o2 = obb2.orientation.asArray;
+	vec3 a[] = { vec3(o1[0], o1[1], o1[2]), vec3(o1[3], o1[4], o1[5]), vec3(o1[6], o1[7], o1[8]) };
+	vec3 b[] = { vec3(o2[0], o2[1], o2[2]), vec3(o2[3], o2[4], o2[5]), vec3(o2[6], o2[7], o2[8]) };
+	const float* ea = obb1.size.asArray;
+	const float* eb = obb2.size.asArray;
 
-	vec3 test[15] = {
-		vec3(o1[0], o1[1], o1[2]),
-		vec3(o1[3], o1[4], o1[5]),
-		vec3(o1[6], o1[7], o1[8]),
-		vec3(o2[0], o2[1], o2[2]),
-		vec3(o2[3], o2[4], o2[5]),
-		vec3(o2[6], o2[7], o2[8])
-	};
-
-	for (int i = 0; i < 3; ++i) { // Fill out rest of axis
-		test[6 + i * 3 + 0] = Cross(test[i], test[0]);
-		test[6 + i * 3 + 1] = Cross(test[i], test[1]);
-		test[6 + i * 3 + 2] = Cross(test[i], test[2]);
+	float R[3][3], absR[3][3];
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			R[i][j] = Dot(a[i], b[j]);
+			// The epsilon keeps the cross product of two nearly
+			// parallel edges from becoming a separating axis
+			absR[i][j] = fabsf(R[i][j]) + 0.00001f;
+		}
 	}
 
-	for (int i = 0; i < 15; ++i) {
-		if (!OverlapOnAxis(obb1, obb2, test[i])) {
+	vec3 d = obb2.position - obb1.position;
+	float t[3] = { Dot(d, a[0]), Dot(d, a[1]), Dot(d, a[2]) };
+
+	bool findDepth = outNormal != 0 || outDepth != 0;
+	float bestDepth = FLT_MAX;
+	vec3 bestAxis;
+	float bestSide = 0.0f;
+
+	// Axis of obb1
+	for (int i = 0; i < 3; ++i) {
+		float rb = eb[0] * absR[i][0] + eb[1] * absR[i][1] + eb[2] * absR[i][2];
+		float depth = OverlapDepth(ea[i], rb, t[i]);
+		if (depth < 0.0f) {
 			return false; // Seperating axis found
 		}
+		if (findDepth && depth < bestDepth) {
+			bestDepth = depth;
+			bestAxis = a[i];
+			bestSide = t[i];
+		}
+	}
+
+	// Axis of obb2
+	for (int j = 0; j < 3; ++j) {
+		float ra = ea[0] * absR[0][j] + ea[1] * absR[1][j] + ea[2] * absR[2][j];
+		float distance = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+		float depth = OverlapDepth(ra, eb[j], distance);
+		if (depth < 0.0f) {
+			return false;
+		}
+		if (findDepth && depth < bestDepth) {
+			bestDepth = depth;
+			bestAxis = b[j];
+			bestSide = distance;
+		}
 	}
 
+	// Cross products of one axis from each box
+	for (int i = 0; i < 3; ++i) {
+		int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j) {
+			int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+			// |a[i] x b[j]|^2, the axis are unit length
+			float lengthSq = 1.0f - R[i][j] * R[i][j];
+			if (lengthSq < 0.001f) {
+				continue; // Parallel, the face axis already cover it
+			}
+
+			float ra = ea[i1] * absR[i2][j] + ea[i2] * absR[i1][j];
+			float rb = eb[j1] * absR[i][j2] + eb[j2] * absR[i][j1];
+			float distance = t[i2] * R[i1][j] - t[i1] * R[i2][j];
+			float depth = OverlapDepth(ra, rb, distance);
+			if (depth < 0.0f) {
+				return false;
+			}
+			if (findDepth) {
+				depth /= sqrtf(lengthSq); // Depth along the unit axis
+				if (depth < bestDepth) {
+					bestDepth = depth;
+					bestAxis = Cross(a[i], b[j]);
+					bestSide = distance;
+				}
+			}
+		}
+	}
+
+	if (outNormal != 0) {
+		// Point from obb1 towards obb2
+		vec3 normal = Normalized(bestAxis);
+		*outNormal = (bestSide < 0.0f) ? normal * -1.0f : normal;
+	}
+	if (outDepth != 0) {
+		*outDepth = bestDepth;
+	}
 	return true; // Seperating axis not found
 }
 
@@ -854,6 +930,153 @@ bool Linetest(const OBB& obb, const Line& line) {
 	return t >= 0 && t * t <= LengthSq(line);
 }
 
+// End points of the segment at the core of the capsule
+static inline void GetSegment(const Capsule& capsule, Point* outStart, Point* outEnd) {
+	const float* o = capsule.orientation.asArray;
+	vec3 up = vec3(o[3], o[4], o[5]) * capsule.halfHeight;
+	*outStart = capsule.position - up;
+	*outEnd = capsule.position + up;
+}
+
+// Closest points of segments p1-q1 and p2-q2, returns the squared
+// distance between them. Real Time Collision Detection, 5.1.9
+static float ClosestPoints(const Point& p1, const Point& q1, const Point& p2, const Point& q2, Point* outC1, Point* outC2) {
+	vec3 d1 = q1 - p1;
+	vec3 d2 = q2 - p2;
+	vec3 r = p1 - p2;
+	float a = Dot(d1, d1);
+	float e = Dot(d2, d2);
+	float f = Dot(d2, r);
+	float s = 0.0f, t = 0.0f;
+
+	if (a <= 0.0000001f && e <= 0.0000001f) {
+		// Both segments are points
+	}
+	else if (a <= 0.0000001f) {
+		t = CLAMP(f / e, 0.0f, 1.0f);
+	}
+	else {
+		float c = Dot(d1, r);
+		if (e <= 0.0000001f) {
+			s = CLAMP(-c / a, 0.0f, 1.0f);
+		}
+		else {
+			float b = Dot(d1, d2);
+			float denom = a * e - b * b;
+			// Parallel segments pick any s, 0 will do
+			s = (denom != 0.0f) ? CLAMP((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+			t = (b * s + f) / e;
+			if (t < 0.0f) {
+				t = 0.0f;
+				s = CLAMP(-c / a, 0.0f, 1.0f);
+			}
+			else if (t > 1.0f) {
+				t = 1.0f;
+				s = CLAMP((b - c) / a, 0.0f, 1.0f);
+			}
+		}
+	}
+
+	*outC1 = p1 + d1 * s;
+	*outC2 = p2 + d2 * t;
+	return MagnitudeSq(*outC1 - *outC2);
+}
+
+Point ClosestPoint(const Capsule& capsule, const Point& point) {
+	Point start, end;
+	GetSegment(capsule, &start, &end);
+	Point onSegment = ClosestPoint(Line(start, end), point);
+
+	// Same as a sphere around the closest point of the segment
+	vec3 toPoint = point - onSegment;
+	if (MagnitudeSq(toPoint) < 0.0000001f) {
+		const float* o = capsule.orientation.asArray;
+		toPoint = vec3(o[0], o[1], o[2]);
+	}
+	return onSegment + Normalized(toPoint) * capsule.radius;
+}
+
+// The capsule is a cylinder between the centers of two spheres. In
+// the space of the capsule the cylinder is around the Y axis, the
+// ray is tested against it and both spheres. Only the part of each
+// sphere beyond the cylinder counts.
+bool Raycast(const Capsule& capsule, const Ray& ray, RaycastResult* outResult) {
+	ResetRaycastResult(outResult);
+
+	const float* o = capsule.orientation.asArray;
+	vec3 axis[] = { vec3(o[0], o[1], o[2]), vec3(o[3], o[4], o[5]), vec3(o[6], o[7], o[8]) };
+	vec3 p = ray.origin - capsule.position;
+	vec3 origin(Dot(p, axis[0]), Dot(p, axis[1]), Dot(p, axis[2]));
+	vec3 dir(Dot(ray.direction, axis[0]), Dot(ray.direction, axis[1]), Dot(ray.direction, axis[2]));
+	float rSq = capsule.radius * capsule.radius;
+	float h = capsule.halfHeight;
+
+	float tHit = FLT_MAX;
+	vec3 normal;
+
+	// Side of the cylinder
+	float a = dir.x * dir.x + dir.z * dir.z;
+	if (a > 0.0000001f) {
+		float b = origin.x * dir.x + origin.z * dir.z;
+		float c = origin.x * origin.x + origin.z * origin.z - rSq;
+		float discriminant = b * b - a * c;
+		if (discriminant >= 0.0f) {
+			float root = sqrtf(discriminant);
+			float roots[] = { (-b - root) / a, (-b + root) / a };
+			for (int i = 0; i < 2; ++i) {
+				float t = roots[i];
+				float y = origin.y + dir.y * t;
+				if (t >= 0.0f && t < tHit && fabsf(y) <= h) {
+					tHit = t;
+					normal = vec3(origin.x + dir.x * t, 0.0f, origin.z + dir.z * t);
+				}
+			}
+		}
+	}
+
+	// Spheres at both ends
+	a = Dot(dir, dir);
+	for (int end = 0; end < 2; ++end) {
+		float centerY = (end == 0) ? h : -h;
+		vec3 m = origin - vec3(0.0f, centerY, 0.0f);
+		float b = Dot(m, dir);
+		float c = Dot(m, m) - rSq;
+		float discriminant = b * b - a * c;
+		if (discriminant < 0.0f) {
+			continue;
+		}
+		float root = sqrtf(discriminant);
+		float roots[] = { (-b - root) / a, (-b + root) / a };
+		for (int i = 0; i < 2; ++i) {
+			float t = roots[i];
+			float y = origin.y + dir.y * t;
+			bool beyond = (end == 0) ? y >= h : y <= -h;
+			if (t >= 0.0f && t < tHit && beyond) {
+				tHit = t;
+				normal = m + dir * t;
+			}
+		}
+	}
+
+	if (tHit == FLT_MAX) {
+		return false;
+	}
+	if (outResult != 0) {
+		outResult->t = tHit;
+		outResult->hit = true;
+		outResult->point = ray.origin + ray.direction * tHit;
+		outResult->normal = Normalized(MultiplyVector(normal, capsule.orientation));
+	}
+	return true;
+}
+
+bool Linetest(const Capsule& capsule, const Line& line) {
+	Point start, end, onLine, onSegment;
+	GetSegment(capsule, &start, &end);
+	float distSq = ClosestPoints(line.start, line.end, start, end, &onLine, &onSegment);
+	return distSq <= capsule.radius * capsule.radius;
+}
+
 #ifndef NO_EXTRAS
 bool Raycast(const Ray& ray, const Sphere& sphere, RaycastResult* outResult) {
 	return Raycast(sphere, ray, outResult);
@@ -887,6 +1110,14 @@ bool Linetest(const Line& line, const Plane& plane) {
 	return Linetest(plane, line);
 }
 
+bool Raycast(const Ray& ray, const Capsule& capsule, RaycastResult* outResult) {
+	return Raycast(capsule, ray, outResult);
+}
+
+bool Linetest(const Line& line, const Capsule& capsule) {
+	return Linetest(capsule, line);
+}
+
 vec3 Centroid(const Triangle& t) {
 	vec3 result;
 	result.x = t.a.x + t.b.x + t.c.x;
@@ -1279,6 +1510,7 @@ bool Linetest(const Triangle& triangle, const Line& line) {
 }
 
 void AccelerateMesh(Mesh& mesh) {
+	TRACE_SCOPE("AccelerateMesh");
 	if (mesh.accelerator != 0) {
 		return;
 	}
@@ -1300,7 +1532,7 @@ void AccelerateMesh(Mesh& mesh) {
 	mesh.accelerator->bounds = FromMinMax(min, max);
 	mesh.accelerator->children = 0;
 	mesh.accelerator->numTriangles = mesh.numTriangles;
-	mesh.accelerator->triangles = new int[mesh.numTriangles];
+	mesh.accelerator->triangles = (int*)TaggedAlloc(sizeof(int) * mesh.numTriangles, MEMORY_TAG_BVH);
 	for (int i = 0; i < mesh.numTriangles; ++i) {
 		mesh.accelerator->triangles[i] = i;
 	}
@@ -1308,6 +1540,19 @@ void AccelerateMesh(Mesh& mesh) {
 	SplitBVHNode(mesh.accelerator, mesh, 3);
 }
 
+typedef struct SplitBVHJobData {
+	BVHNode* children;
+	const Mesh* model;
+	int depth;
+} SplitBVHJobData;
+
+static void SplitBVHJob(void* data, int begin, int end) {
+	SplitBVHJobData& job = *(SplitBVHJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		SplitBVHNode(&job.children[i], *job.model, job.depth);
+	}
+}
+
 void SplitBVHNode(BVHNode* node, const Mesh& model, int depth) {
 	if (depth-- <= 0) { // Decrements depth
 		return;
@@ -1347,7 +1592,7 @@ void SplitBVHNode(BVHNode* node, const Mesh& model, int depth) {
 			if (node->children[i].numTriangles == 0) {
 				continue;
 			}
-			node->children[i].triangles = new int[node->children[i].numTriangles];
+			node->children[i].triangles = (int*)TaggedAlloc(sizeof(int) * node->children[i].numTriangles, MEMORY_TAG_BVH);
 			int index = 0; // Add the triangles in the new child arrau
 			for (int j = 0; j < node->numTriangles; ++j) {
 				Triangle t = model.triangles[node->triangles[j]];
@@ -1358,12 +1603,13 @@ void SplitBVHNode(BVHNode* node, const Mesh& model, int depth) {
 		}
 
 		node->numTriangles = 0;
-		delete[] node->triangles;
+		TaggedFree(node->triangles);
 		node->triangles = 0;
 
-		// Recurse
-		for (int i = 0; i < 8; ++i) {
-			SplitBVHNode(&node->children[i], model, depth);
+		// Recurse, the children share nothing so each is a job
+		if (depth > 0) {
+			SplitBVHJobData job = { node->children, &model, depth };
+			ParallelFor(8, 1, SplitBVHJob, &job);
 		}
 	}
 }
@@ -1378,7 +1624,7 @@ void FreeBVHNode(BVHNode* node) {
 	}
 
 	if (node->numTriangles != 0 || node->triangles != 0) {
-		delete[] node->triangles;
+		TaggedFree(node->triangles);
 		node->triangles = 0;
 		node->numTriangles = 0;
 	}
@@ -1888,14 +2134,21 @@ Point Intersection(Plane p1, Plane p2, Plane p3) {
 }
 
 void GetCorners(const Frustum& f, vec3* outCorners) {
-	outCorners[0] = Intersection(f._near, f.top,    f.left);
-	outCorners[1] = Intersection(f._near, f.top,    f.right);
-	outCorners[2] = Intersection(f._near, f.bottom, f.left);
-	outCorners[3] = Intersection(f._near, f.bottom, f.right);
-	outCorners[4] = Intersection(f._far,  f.top,    f.left);
-	outCorners[5] = Intersection(f._far,  f.top,    f.right);
-	outCorners[6] = Intersection(f._far,  f.bottom, f.left);
-	outCorners[7] = Intersection(f._far,  f.bottom, f.right);
+	const Plane& top = f.planes[0];
+	const Plane& bottom = f.planes[1];
+	const Plane& left = f.planes[2];
+	const Plane& right = f.planes[3];
+	const Plane& _near = f.planes[4];
+	const Plane& _far = f.planes[5];
+
+	outCorners[0] = Intersection(_near, top,    left);
+	outCorners[1] = Intersection(_near, top,    right);
+	outCorners[2] = Intersection(_near, bottom, left);
+	outCorners[3] = Intersection(_near, bottom, right);
+	outCorners[4] = Intersection(_far,  top,    left);
+	outCorners[5] = Intersection(_far,  top,    right);
+	outCorners[6] = Intersection(_far,  bottom, left);
+	outCorners[7] = Intersection(_far,  bottom, right);
 }
 
 bool Intersects(const Frustum& f, const Point& p) {
@@ -2055,16 +2308,11 @@ void ResetCollisionManifold(CollisionManifold* result) {
 		result->colliding = false;
 		result->normal = vec3(0, 0, 1);
 		result->depth = FLT_MAX;
-		if (result->contacts.size() > 0) {
-			result->contacts.clear();
-		}
+		result->numContacts = 0;
 	}
 }
 
-std::vector<Point> GetVertices(const OBB& obb) {
-	std::vector<vec3> v;
-	v.resize(8);
-
+void GetVertices(const OBB& obb, Point outVertices[8]) {
 	vec3 C = obb.position;	// OBB Center
 	vec3 E = obb.size;		// OBB Extents
 	const float* o = obb.orientation.asArray;
@@ -2074,22 +2322,19 @@ std::vector<Point> GetVertices(const OBB& obb) {
 		vec3(o[6], o[7], o[8]),
 	};
 
-	v[0] = C + A[0] * E[0] + A[1] * E[1] + A[2] * E[2];
-	v[1] = C - A[0] * E[0] + A[1] * E[1] + A[2] * E[2];
-	v[2] = C + A[0] * E[0] - A[1] * E[1] + A[2] * E[2];
-	v[3] = C + A[0] * E[0] + A[1] * E[1] - A[2] * E[2];
-	v[4] = C - A[0] * E[0] - A[1] * E[1] - A[2] * E[2];
-	v[5] = C + A[0] * E[0] - A[1] * E[1] - A[2] * E[2];
-	v[6] = C - A[0] * E[0] + A[1] * E[1] - A[2] * E[2];
-	v[7] = C - A[0] * E[0] - A[1] * E[1] + A[2] * E[2];
-
-	return v;
+	outVertices[0] = C + A[0] * E[0] + A[1] * E[1] + A[2] * E[2];
+	outVertices[1] = C - A[0] * E[0] + A[1] * E[1] + A[2] * E[2];
+	outVertices[2] = C + A[0] * E[0] - A[1] * E[1] + A[2] * E[2];
+	outVertices[3] = C + A[0] * E[0] + A[1] * E[1] - A[2] * E[2];
+	outVertices[4] = C - A[0] * E[0] - A[1] * E[1] - A[2] * E[2];
+	outVertices[5] = C + A[0] * E[0] - A[1] * E[1] - A[2] * E[2];
+	outVertices[6] = C - A[0] * E[0] + A[1] * E[1] - A[2] * E[2];
+	outVertices[7] = C - A[0] * E[0] - A[1] * E[1] + A[2] * E[2];
 }
 
-std::vector<Line> GetEdges(const OBB& obb) {
-	std::vector<Line> result;
-	result.reserve(12);
-	std::vector<Point> v = GetVertices(obb);
+void GetEdges(const OBB& obb, Line outEdges[12]) {
+	Point v[8];
+	GetVertices(obb, v);
 
 	int index[][2] = { // Indices of edges
 		{ 6, 1 },{ 6, 3 },{ 6, 4 },{ 2, 7 },{ 2, 5 },{ 2, 0 },
@@ -2097,15 +2342,11 @@ std::vector<Line> GetEdges(const OBB& obb) {
 	};
 
 	for (int j = 0; j < 12; ++j) {
-		result.push_back(Line(
-			v[index[j][0]], v[index[j][1]]
-		));
+		outEdges[j] = Line(v[index[j][0]], v[index[j][1]]);
 	}
-
-	return result;
 }
 
-std::vector<Plane> GetPlanes(const OBB& obb) {
+void GetPlanes(const OBB& obb, Plane outPlanes[6]) {
 	vec3 c = obb.position;	// OBB Center
 	vec3 e = obb.size;		// OBB Extents
 	const float* o = obb.orientation.asArray;
@@ -2115,19 +2356,31 @@ std::vector<Plane> GetPlanes(const OBB& obb) {
 		vec3(o[6], o[7], o[8]),
 	};
 
-	std::vector<Plane> result;
-	result.resize(6);
+	outPlanes[0] = Plane(a[0]        ,  Dot(a[0], (c + a[0] * e.x)));
+	outPlanes[1] = Plane(a[0] * -1.0f, -Dot(a[0], (c - a[0] * e.x)));
+	outPlanes[2] = Plane(a[1]        ,  Dot(a[1], (c + a[1] * e.y)));
+	outPlanes[3] = Plane(a[1] * -1.0f, -Dot(a[1], (c - a[1] * e.y)));
+	outPlanes[4] = Plane(a[2]        ,  Dot(a[2], (c + a[2] * e.z)));
+	outPlanes[5] = Plane(a[2] * -1.0f, -Dot(a[2], (c - a[2] * e.z)));
+}
 
-	result[0] = Plane(a[0]        ,  Dot(a[0], (c + a[0] * e.x)));
-	result[1] = Plane(a[0] * -1.0f, -Dot(a[0], (c - a[0] * e.x)));
-	result[2] = Plane(a[1]        ,  Dot(a[1], (c + a[1] * e.y)));
-	result[3] = Plane(a[1] * -1.0f, -Dot(a[1], (c - a[1] * e.y)));
-	result[4] = Plane(a[2]        ,  Dot(a[2], (c + a[2] * e.z)));
-	result[5] = Plane(a[2] * -1.0f, -Dot(a[2], (c - a[2] * e.z)));
+std::vector<Point> GetVertices(const OBB& obb) {
+	std::vector<Point> result(8);
+	GetVertices(obb, &result[0]);
+	return result;
+}
 
+std::vector<Line> GetEdges(const OBB& obb) {
+	std::vector<Line> result(12);
+	GetEdges(obb, &result[0]);
 	return result;
 }
 
+std::vector<Plane> GetPlanes(const OBB& obb) {
+	std::vector<Plane> result(6);
+	GetPlanes(obb, &result[0]);
+	return result;
+}
 
 bool ClipToPlane(const Plane& plane, const Line& line, Point* outPoint) {
 	vec3 ab = line.end - line.start;
@@ -2150,23 +2403,37 @@ bool ClipToPlane(const Plane& plane, const Line& line, Point* outPoint) {
 	return false;
 }
 
-std::vector<Point> ClipEdgesToOBB(const std::vector<Line>& edges, const OBB& obb) {
-	std::vector<Point> result;
-	result.reserve(edges.size() * 3);
+int ClipEdgesToOBB(const Line* edges, int numEdges, const OBB& obb, Point* outPoints, int maxPoints) {
+	int numPoints = 0;
 	Point intersection;
 
-	std::vector<Plane>& planes = GetPlanes(obb);
+	Plane planes[6];
+	GetPlanes(obb, planes);
 
-	for (int i = 0; i < planes.size(); ++i) {
-		for (int j = 0; j < edges.size(); ++j) {
-			if (ClipToPlane(planes[i], edges[j], &intersection)) {
+	for (int i = 0; i < 6; ++i) {
+		for (int j = 0; j < numEdges; ++j) {
+			if (numPoints < maxPoints && ClipToPlane(planes[i], edges[j], &intersection)) {
 				if (PointInOBB(intersection, obb)) {
-					result.push_back(intersection);
+					outPoints[numPoints++] = intersection;
 				}
 			}
 		}
 	}
 
+	return numPoints;
+}
+
+std::vector<Point> ClipEdgesToOBB(const std::vector<Line>& edges, const OBB& obb) {
+	std::vector<Point> result;
+	if (edges.size() == 0) {
+		return result;
+	}
+
+	// Every edge can hit every plane
+	result.resize(edges.size() * 6);
+	int numPoints = ClipEdgesToOBB(&edges[0], edges.size(), obb, &result[0], result.size());
+	result.resize(numPoints);
+
 	return result;
 }
 
@@ -2191,102 +2458,734 @@ float PenetrationDepth(const OBB& o1, const OBB& o2, const vec3& axis, bool* out
 	return (len1 + len2) - length;
 }
 
-CollisionManifold FindCollisionFeatures(const OBB& A, const OBB& B) {
-	CollisionManifold result; // Will return result of intersection!
+// Keeps at most 4 of the candidate contacts, the ones that span the
+// largest area. The deepest point is always kept, then the point
+// furthest from it, then the points furthest to either side of the
+// line between those two. Duplicates are never picked.
+void ReduceContacts(CollisionManifold* result, const vec3& normal, const Point* points, const float* depths, int numPoints) {
+	result->numContacts = 0;
+	if (numPoints <= 0) {
+		return;
+	}
+
+	int picked[4] = { 0, -1, -1, -1 };
+	for (int i = 1; i < numPoints; ++i) {
+		if (depths[i] > depths[picked[0]]) {
+			picked[0] = i;
+		}
+	}
+
+	float best = 0.0001f; // Closer than this is a duplicate
+	for (int i = 0; i < numPoints; ++i) {
+		float distSq = MagnitudeSq(points[i] - points[picked[0]]);
+		if (distSq > best) {
+			best = distSq;
+			picked[1] = i;
+		}
+	}
+
+	if (picked[1] != -1) {
+		// Signed area of the triangle each point makes with the first two
+		float most = 0.0001f, least = -0.0001f;
+		for (int i = 0; i < numPoints; ++i) {
+			float area = Dot(Cross(points[picked[0]] - points[i], points[picked[1]] - points[i]), normal);
+			if (area > most) {
+				most = area;
+				picked[2] = i;
+			}
+			else if (area < least) {
+				least = area;
+				picked[3] = i;
+			}
+		}
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		if (picked[i] != -1) {
+			result->contacts[result->numContacts] = points[picked[i]];
+			result->depths[result->numContacts] = depths[picked[i]];
+			result->numContacts += 1;
+		}
+	}
+}
+
+// The face of the box that points the most along dir, as 4 corners
+static void GetSupportFace(const OBB& box, const vec3& dir, Point outFace[4], vec3* outNormal, float* outAlignment) {
+	const float* o = box.orientation.asArray;
+	vec3 axis[] = {
+		vec3(o[0], o[1], o[2]),
+		vec3(o[3], o[4], o[5]),
+		vec3(o[6], o[7], o[8]),
+	};
+
+	int k = 0;
+	float alignment = Dot(axis[0], dir);
+	for (int i = 1; i < 3; ++i) {
+		float d = Dot(axis[i], dir);
+		if (fabsf(d) > fabsf(alignment)) {
+			alignment = d;
+			k = i;
+		}
+	}
+
+	const float* e = box.size.asArray;
+	vec3 normal = (alignment < 0.0f) ? axis[k] * -1.0f : axis[k];
+	vec3 center = box.position + normal * e[k];
+	vec3 u = axis[(k + 1) % 3] * e[(k + 1) % 3];
+	vec3 v = axis[(k + 2) % 3] * e[(k + 2) % 3];
+
+	outFace[0] = center + u + v;
+	outFace[1] = center - u + v;
+	outFace[2] = center - u - v;
+	outFace[3] = center + u - v;
+	*outNormal = normal;
+	*outAlignment = fabsf(alignment);
+}
+
+// Sutherland-Hodgman, keeps the part of the polygon behind the plane
+static int ClipPolygon(const Plane& plane, const Point* in, int numIn, Point* out) {
+	int numOut = 0;
+	for (int i = 0; i < numIn; ++i) {
+		const Point& a = in[i];
+		const Point& b = in[(i + 1) % numIn];
+		float da = PlaneEquation(a, plane);
+		float db = PlaneEquation(b, plane);
+
+		if (da <= 0.0f) {
+			out[numOut++] = a;
+		}
+		if ((da < 0.0f && db > 0.0f) || (da > 0.0f && db < 0.0f)) {
+			out[numOut++] = a + (b - a) * (da / (da - db));
+		}
+	}
+	return numOut;
+}
+
+// Clips the incident face (the face of one box facing the other) to
+// the side planes of the reference face (the face of the other box
+// most aligned with the normal). The clipped points below the
+// reference face are the contacts. normal goes from A to B.
+static void ClipBoxFaces(const OBB& A, const OBB& B, const vec3& normal, CollisionManifold* result) {
+	Point faceA[4], faceB[4];
+	vec3 normalA, normalB;
+	float alignA, alignB;
+	GetSupportFace(A, normal, faceA, &normalA, &alignA);
+	GetSupportFace(B, normal * -1.0f, faceB, &normalB, &alignB);
+
+	// Prefer A, so the reference face doesn't flip between frames
+	bool flip = alignB > alignA + 0.001f;
+	const OBB& incidentBox = flip ? A : B;
+	const Point* refFace = flip ? faceB : faceA;
+	vec3 refNormal = flip ? normalB : normalA;
+
+	Point incident[4];
+	vec3 incidentNormal;
+	float incidentAlign;
+	GetSupportFace(incidentBox, refNormal * -1.0f, incident, &incidentNormal, &incidentAlign);
+
+	// Every clip adds at most one point, 4 planes turn 4 points into 8
+	Point buffer[2][8];
+	for (int i = 0; i < 4; ++i) {
+		buffer[0][i] = incident[i];
+	}
+	int numPoints = 4;
+	int current = 0;
+	vec3 refCenter = (refFace[0] + refFace[2]) * 0.5f;
+	for (int i = 0; i < 4 && numPoints > 0; ++i) {
+		vec3 edge = refFace[(i + 1) % 4] - refFace[i];
+		vec3 sideNormal = Normalized(Cross(edge, refNormal));
+		if (Dot(sideNormal, refCenter - refFace[i]) > 0.0f) {
+			sideNormal = sideNormal * -1.0f; // Must point out of the face
+		}
+		Plane side(sideNormal, Dot(sideNormal, refFace[i]));
+		numPoints = ClipPolygon(side, buffer[current], numPoints, buffer[1 - current]);
+		current = 1 - current;
+	}
+
+	Point points[8];
+	float depths[8];
+	int numContacts = 0;
+	float refDistance = Dot(refNormal, refFace[0]);
+	for (int i = 0; i < numPoints; ++i) {
+		float separation = Dot(refNormal, buffer[current][i]) - refDistance;
+		if (separation <= 0.0f) {
+			// Halfway between the incident point and the reference face
+			points[numContacts] = buffer[current][i] - refNormal * (separation * 0.5f);
+			depths[numContacts] = -separation;
+			numContacts += 1;
+		}
+	}
+
+	ReduceContacts(result, normal, points, depths, numContacts);
+}
+
+void FindCollisionFeatures(const OBB& A, const OBB& B, CollisionManifold* outResult) {
+	CollisionManifold& result = *outResult;
 	ResetCollisionManifold(&result);
 
 	Sphere s1(A.position, Magnitude(A.size));
 	Sphere s2(B.position, Magnitude(B.size));
 
 	if (!SphereSphere(s1, s2)) {
-		return result;
+		return;
 	}
 
-	const float* o1 = A.orientation.asArray;
-	const float* o2 = B.orientation.asArray;
+	vec3 axis;
+	float depth;
+	if (!OBBOBBPenetration(A, B, &axis, &depth) || depth <= 0.0f) {
+		return;
+	}
+	result.depth = depth;
+
+	ClipBoxFaces(A, B, axis, &result);
+	if (result.numContacts == 0) {
+		// The faces missed each other (edge on edge), fall back to
+		// clipping every edge of each box against the other box.
+		// Worst case every edge hits every plane of the other box
+		Point clipped[12 * 6 * 2];
+		Line edges[12];
+		GetEdges(B, edges);
+		int numClipped = ClipEdgesToOBB(edges, 12, A, clipped, 12 * 6);
+		GetEdges(A, edges);
+		numClipped += ClipEdgesToOBB(edges, 12, B, clipped + numClipped, 12 * 6);
+
+		Interval i = GetInterval(A, axis);
+		float distance = (i.max - i.min)* 0.5f - result.depth * 0.5f;
+		vec3 pointOnPlane = A.position + axis * distance;
+
+		float depths[12 * 6 * 2];
+		for (int i = 0; i < numClipped; ++i) {
+			vec3 contact = clipped[i];
+			clipped[i] = contact + (axis * Dot(axis, pointOnPlane - contact));
+			depths[i] = result.depth;
+		}
+		ReduceContacts(&result, axis, clipped, depths, numClipped);
+	}
 
-	vec3 test[15] = {
-		vec3(o1[0], o1[1], o1[2]),
-		vec3(o1[3], o1[4], o1[5]),
-		vec3(o1[6], o1[7], o1[8]),
-		vec3(o2[0], o2[1], o2[2]),
-		vec3(o2[3], o2[4], o2[5]),
-		vec3(o2[6], o2[7], o2[8])
-	};
+	result.colliding = true;
+	result.normal = axis;
+}
 
-	for (int i = 0; i < 3; ++i) { // Fill out rest of axis
-		test[6 + i * 3 + 0] = Cross(test[i], test[0]);
-		test[6 + i * 3 + 1] = Cross(test[i], test[1]);
-		test[6 + i * 3 + 2] = Cross(test[i], test[2]);
+CollisionManifold FindCollisionFeatures(const OBB& A, const OBB& B) {
+	CollisionManifold result; // Will return result of intersection!
+	FindCollisionFeatures(A, B, &result);
+	return result;
+}
+
+// Adds a contact between a sphere around a and one around b, along
+// normal (from a to b). The contact is halfway between the surfaces
+static void AddSphereContact(const Point& a, float ra, const Point& b, float rb, const vec3& normal, CollisionManifold* result) {
+	float depth = ra + rb - Dot(b - a, normal);
+	if (depth < 0.0f || result->numContacts >= MAX_MANIFOLD_CONTACTS) {
+		return;
 	}
 
-	vec3* hitNormal = 0;
-	bool shouldFlip;
+	Point onA = a + normal * ra;
+	Point onB = b - normal * rb;
+	result->contacts[result->numContacts] = onA + (onB - onA) * 0.5f;
+	result->depths[result->numContacts] = depth;
+	result->numContacts += 1;
+	// Depth of the manifold is the deepest contact
+	if (!result->colliding || depth > result->depth) {
+		result->depth = depth;
+	}
+	result->colliding = true;
+	result->normal = normal;
+}
 
-	for (int i = 0; i < 15; ++i) {
-		if (test[i].x < 0.000001f) test[i].x = 0.0f;
-		if (test[i].y < 0.000001f) test[i].y = 0.0f;
-		if (test[i].z < 0.000001f) test[i].z = 0.0f;
-		if (MagnitudeSq(test[i])< 0.001f) {
-			continue;
+// Direction from a to b, or fallback if they are the same point
+static inline vec3 Direction(const Point& a, const Point& b, const vec3& fallback) {
+	vec3 d = b - a;
+	float lengthSq = MagnitudeSq(d);
+	if (lengthSq < 0.0000001f) {
+		return fallback;
+	}
+	return d * (1.0f / sqrtf(lengthSq));
+}
+
+void FindCollisionFeatures(const Capsule& A, const Sphere& B, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	Point start, end;
+	GetSegment(A, &start, &end);
+	Point onSegment = ClosestPoint(Line(start, end), B.position);
+
+	float r = A.radius + B.radius;
+	if (MagnitudeSq(B.position - onSegment) > r * r) {
+		return;
+	}
+
+	const float* o = A.orientation.asArray;
+	vec3 normal = Direction(onSegment, B.position, vec3(o[0], o[1], o[2]));
+	AddSphereContact(onSegment, A.radius, B.position, B.radius, normal, result);
+}
+
+void FindCollisionFeatures(const Capsule& A, const Capsule& B, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	// Bounding spheres first, most pairs are far apart
+	float reach = A.halfHeight + A.radius + B.halfHeight + B.radius;
+	if (MagnitudeSq(B.position - A.position) > reach * reach) {
+		return;
+	}
+
+	Point a0, a1, b0, b1, onA, onB;
+	GetSegment(A, &a0, &a1);
+	GetSegment(B, &b0, &b1);
+	float distSq = ClosestPoints(a0, a1, b0, b1, &onA, &onB);
+
+	float r = A.radius + B.radius;
+	if (distSq > r * r) {
+		return;
+	}
+
+	vec3 dA = a1 - a0;
+	vec3 dB = b1 - b0;
+	vec3 cross = Cross(dA, dB);
+
+	vec3 normal;
+	if (distSq > 0.0000001f) {
+		normal = (onB - onA) * (1.0f / sqrtf(distSq));
+	}
+	else {
+		// The segments cross, push apart along both of them
+		vec3 fallback = Direction(A.position, B.position, vec3(0.0f, 1.0f, 0.0f));
+		normal = Direction(vec3(), cross, fallback);
+		if (Dot(normal, B.position - A.position) < 0.0f) {
+			normal = normal * -1.0f;
 		}
+	}
 
-		float depth = PenetrationDepth(A, B, test[i], &shouldFlip);
-		if (depth <= 0.0f) {
-			return result;
+	// Parallel capsules touch along a line. A contact at both ends of
+	// it keeps them from rocking around a single point
+	float lengthSqA = MagnitudeSq(dA);
+	if (lengthSqA > 0.0000001f && MagnitudeSq(cross) < 0.001f * lengthSqA * MagnitudeSq(dB)) {
+		float t0 = Dot(b0 - a0, dA) / lengthSqA;
+		float t1 = Dot(b1 - a0, dA) / lengthSqA;
+		if (t0 > t1) {
+			float t = t0;
+			t0 = t1;
+			t1 = t;
 		}
-		else if (depth < result.depth) {
-			if (shouldFlip) {
-				test[i] = test[i] * -1.0f;
+		t0 = fmaxf(t0, 0.0f);
+		t1 = fminf(t1, 1.0f);
+		if (t1 - t0 > 0.001f) {
+			Line segmentB(b0, b1);
+			Point p0 = a0 + dA * t0;
+			Point p1 = a0 + dA * t1;
+			AddSphereContact(p0, A.radius, ClosestPoint(segmentB, p0), B.radius, normal, result);
+			AddSphereContact(p1, A.radius, ClosestPoint(segmentB, p1), B.radius, normal, result);
+			if (result->numContacts > 0) {
+				return;
 			}
-			result.depth = depth;
-			hitNormal = &test[i];
 		}
 	}
 
-	if (hitNormal == 0) {
-		return result;
+	AddSphereContact(onA, A.radius, onB, B.radius, normal, result);
+}
+
+// Closest points of a segment and the surface of a box the segment
+// does not touch. Either an end of the segment is closest, or the
+// segment passes closest to one of the edges of the box
+static float ClosestPoints(const Point& start, const Point& end, const OBB& obb, Point* outOnSegment, Point* outOnBox) {
+	*outOnSegment = start;
+	*outOnBox = ClosestPoint(obb, start);
+	float bestSq = MagnitudeSq(*outOnBox - start);
+
+	Point onBox = ClosestPoint(obb, end);
+	float distSq = MagnitudeSq(onBox - end);
+	if (distSq < bestSq) {
+		bestSq = distSq;
+		*outOnSegment = end;
+		*outOnBox = onBox;
 	}
-	vec3 axis = Normalized(*hitNormal);
 
-	std::vector<Point> c1 = ClipEdgesToOBB(GetEdges(B), A);
-	std::vector<Point> c2 = ClipEdgesToOBB(GetEdges(A), B);
-	result.contacts.reserve(c1.size() + c2.size());
-	result.contacts.insert(result.contacts.end(), c1.begin(), c1.end());
-	result.contacts.insert(result.contacts.end(), c2.begin(), c2.end());
+	Line edges[12];
+	GetEdges(obb, edges);
+	for (int i = 0; i < 12; ++i) {
+		Point onSegment, onEdge;
+		distSq = ClosestPoints(start, end, edges[i].start, edges[i].end, &onSegment, &onEdge);
+		if (distSq < bestSq) {
+			bestSq = distSq;
+			*outOnSegment = onSegment;
+			*outOnBox = onEdge;
+		}
+	}
 
-	Interval i = GetInterval(A, axis);
-	float distance = (i.max - i.min)* 0.5f - result.depth * 0.5f;
-	vec3 pointOnPlane = A.position + axis * distance;
-	
-	for (int i = result.contacts.size() - 1; i >= 0; --i) {
-		vec3 contact = result.contacts[i];
-		result.contacts[i] = contact + (axis * Dot(axis, pointOnPlane - contact));
-		
-		// This bit is in the "There is more" section of the book
-		for (int j = result.contacts.size() - 1; j > i; --j) {
-			if (MagnitudeSq(result.contacts[j] - result.contacts[i]) < 0.0001f) {
-				result.contacts.erase(result.contacts.begin() + j);
-				break;
+	return bestSq;
+}
+
+void FindCollisionFeatures(const Capsule& A, const OBB& B, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	Point start, end;
+	GetSegment(A, &start, &end);
+	float r = A.radius;
+
+	// Most pairs are far apart, reject them on the axis of the box
+	// before finding closest points
+	const float* o = B.orientation.asArray;
+	const float* e = B.size.asArray;
+	vec3 axis[] = { vec3(o[0], o[1], o[2]), vec3(o[3], o[4], o[5]), vec3(o[6], o[7], o[8]) };
+	vec3 halfSegment = (end - start) * 0.5f;
+	vec3 d = B.position - A.position;
+	for (int i = 0; i < 3; ++i) {
+		if (fabsf(Dot(d, axis[i])) > e[i] + fabsf(Dot(halfSegment, axis[i])) + r) {
+			return;
+		}
+	}
+
+	// Linetest misses segments that are all the way inside
+	if (!PointInOBB(start, B) && !Linetest(B, Line(start, end))) {
+		// Only the round part touches the box, this is a sphere
+		// around the closest point of the segment against the box
+		Point onSegment, onBox;
+		float distSq = ClosestPoints(start, end, B, &onSegment, &onBox);
+		if (distSq > r * r) {
+			return;
+		}
+		vec3 normal = Direction(onSegment, onBox, Direction(A.position, B.position, vec3(0.0f, -1.0f, 0.0f)));
+		AddSphereContact(onSegment, r, onBox, 0.0f, normal, result);
+
+		// A capsule lying on a face touches it along a line, add
+		// the ends of the segment too so it doesn't rock
+		Point ends[] = { start, end };
+		for (int i = 0; i < 2; ++i) {
+			if (MagnitudeSq(ends[i] - onSegment) < 0.0001f) {
+				continue;
+			}
+			Point closest = ClosestPoint(B, ends[i]);
+			if (MagnitudeSq(closest - ends[i]) <= r * r) {
+				AddSphereContact(ends[i], r, closest, 0.0f, normal, result);
 			}
 		}
+		return;
 	}
 
-	result.colliding = true;
-	result.normal = axis;
+	// The segment is in the box. Separating axis test of the segment,
+	// grown by the radius, against the box: the axis of the box and
+	// the cross product of each with the segment
+	vec3 test[6] = { axis[0], axis[1], axis[2] };
+	for (int i = 0; i < 3; ++i) {
+		test[3 + i] = Cross(halfSegment, axis[i]);
+	}
 
-	return result;
+	float bestDepth = FLT_MAX;
+	vec3 normal;
+	float boxRadius = 0.0f;
+	for (int i = 0; i < 6; ++i) {
+		float lengthSq = MagnitudeSq(test[i]);
+		if (lengthSq < 0.0001f) {
+			continue; // Segment is parallel to that axis of the box
+		}
+		vec3 n = test[i] * (1.0f / sqrtf(lengthSq));
+		float rb = e[0] * fabsf(Dot(axis[0], n)) + e[1] * fabsf(Dot(axis[1], n)) + e[2] * fabsf(Dot(axis[2], n));
+		float ra = fabsf(Dot(halfSegment, n)) + r;
+		float distance = Dot(d, n);
+		float depth = ra + rb - fabsf(distance);
+		if (depth < bestDepth) {
+			bestDepth = depth;
+			normal = (distance < 0.0f) ? n * -1.0f : n;
+			boxRadius = rb;
+		}
+	}
+
+	// Ends of the segment that are in the box, deepest first. The
+	// contacts are halfway into the overlap along the normal
+	float boxNear = Dot(normal, B.position) - boxRadius;
+	Point ends[] = { start, end };
+	for (int i = 0; i < 2; ++i) {
+		float depth = Dot(normal, ends[i]) + r - boxNear;
+		if (depth > 0.0f) {
+			result->contacts[result->numContacts] = ends[i] + normal * (r - depth * 0.5f);
+			result->depths[result->numContacts] = depth;
+			result->numContacts += 1;
+		}
+	}
+	if (result->numContacts == 0) {
+		result->contacts[0] = A.position + normal * r;
+		result->depths[0] = bestDepth;
+		result->numContacts = 1;
+	}
+
+	result->colliding = true;
+	result->normal = normal;
+	result->depth = bestDepth;
 }
 
-CollisionManifold FindCollisionFeatures(const Sphere& A, const Sphere& B) {
-	CollisionManifold result; // Will return result of intersection!
+// Closest point of the triangle to p, by the region of the triangle p
+// is in (Ericson, Real-Time Collision Detection 5.1.5). Unlike
+// ClosestPoint(Triangle) this is right near the corners too
+static Point ClosestPointOnTriangle(const Triangle& t, const Point& p) {
+	vec3 ab = t.b - t.a;
+	vec3 ac = t.c - t.a;
+	vec3 ap = p - t.a;
+	float d1 = Dot(ab, ap);
+	float d2 = Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		return t.a;
+	}
+
+	vec3 bp = p - t.b;
+	float d3 = Dot(ab, bp);
+	float d4 = Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		return t.b;
+	}
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return t.a + ab * (d1 / (d1 - d3));
+	}
+
+	vec3 cp = p - t.c;
+	float d5 = Dot(ab, cp);
+	float d6 = Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		return t.c;
+	}
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return t.a + ac * (d2 / (d2 - d6));
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return t.b + (t.c - t.b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	return t.a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Triangles are two sided. This is the unit normal of the triangle
+// that points away from p, the direction from p into the triangle
+static vec3 FaceNormalFrom(const Triangle& t, const Point& p) {
+	vec3 normal = Cross(t.b - t.a, t.c - t.a);
+	float lengthSq = MagnitudeSq(normal);
+	if (lengthSq < 0.0000001f) {
+		return vec3(0.0f, -1.0f, 0.0f); // No area, any normal will do
+	}
+	normal = normal * (1.0f / sqrtf(lengthSq));
+	return (Dot(normal, p - t.a) > 0.0f) ? normal * -1.0f : normal;
+}
+
+// Moves p onto the plane of the triangle, false if it lands outside
+static bool ProjectOntoTriangle(const Triangle& t, const vec3& normal, const Point& p, Point* outPoint) {
+	*outPoint = p - normal * Dot(normal, p - t.a);
+	return PointInTriangle(*outPoint, t);
+}
+
+void FindCollisionFeatures(const Sphere& A, const Triangle& B, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	Point closest = ClosestPointOnTriangle(B, A.position);
+	if (MagnitudeSq(closest - A.position) > A.radius * A.radius) {
+		return;
+	}
+
+	vec3 normal = Direction(A.position, closest, FaceNormalFrom(B, A.position));
+	AddSphereContact(A.position, A.radius, closest, 0.0f, normal, result);
+}
+
+void FindCollisionFeatures(const Capsule& A, const Triangle& B, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	Point start, end;
+	GetSegment(A, &start, &end);
+	float r = A.radius;
+	vec3 face = FaceNormalFrom(B, A.position);
+	Point ends[] = { start, end };
+
+	// Both ends too far in front of the plane of the triangle
+	float startSide = Dot(face, start - B.a);
+	float endSide = Dot(face, end - B.a);
+	if (startSide < -r && endSide < -r) {
+		return;
+	}
+
+	// Closest points of the segment and the triangle. Either an end
+	// of the segment against the face, or the segment against an edge
+	Point onSegment, onTriangle;
+	float best = FLT_MAX;
+	for (int i = 0; i < 2; ++i) {
+		Point projected;
+		if (ProjectOntoTriangle(B, face, ends[i], &projected)) {
+			float distSq = MagnitudeSq(projected - ends[i]);
+			if (distSq < best) {
+				best = distSq;
+				onSegment = ends[i];
+				onTriangle = projected;
+			}
+		}
+	}
+	Point corners[] = { B.a, B.b, B.c };
+	for (int i = 0; i < 3; ++i) {
+		Point s, t;
+		float distSq = ClosestPoints(start, end, corners[i], corners[(i + 1) % 3], &s, &t);
+		if (distSq < best) {
+			best = distSq;
+			onSegment = s;
+			onTriangle = t;
+		}
+	}
+
+	// The segment goes through the triangle. Push the end that is
+	// through back out along the face, if it's over the face
+	if ((startSide > 0.0f) != (endSide > 0.0f)) {
+		Point hit = start + (end - start) * (startSide / (startSide - endSide));
+		if (PointInTriangle(hit, B)) {
+			Point through = (startSide > 0.0f) ? start : end;
+			Point projected;
+			best = 0.0f;
+			if (ProjectOntoTriangle(B, face, through, &projected)) {
+				onSegment = through;
+				onTriangle = projected;
+			}
+			else {
+				onSegment = onTriangle = hit;
+			}
+		}
+	}
+
+	if (best > r * r) {
+		return;
+	}
+
+	vec3 normal = (best == 0.0f) ? face : Direction(onSegment, onTriangle, face);
+	AddSphereContact(onSegment, r, onTriangle, 0.0f, normal, result);
+
+	// A capsule lying on the face touches it along a line, add the
+	// other end too so it doesn't rock
+	for (int i = 0; i < 2; ++i) {
+		Point projected;
+		if (MagnitudeSq(ends[i] - onSegment) > 0.0001f && ProjectOntoTriangle(B, face, ends[i], &projected) &&
+			MagnitudeSq(projected - ends[i]) <= r * r) {
+			AddSphereContact(ends[i], r, projected, 0.0f, normal, result);
+		}
+	}
+}
+
+void FindCollisionFeatures(const OBB& A, const Triangle& B, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	const float* o = A.orientation.asArray;
+	const float* e = A.size.asArray;
+	vec3 axis[] = { vec3(o[0], o[1], o[2]), vec3(o[3], o[4], o[5]), vec3(o[6], o[7], o[8]) };
+	Point corners[] = { B.a, B.b, B.c };
+	vec3 edges[] = { B.b - B.a, B.c - B.b, B.a - B.c };
+	vec3 face = Cross(edges[0], edges[1]);
+	if (MagnitudeSq(face) < 0.0000001f) {
+		return; // No area
+	}
+
+	// Separating axis test. The face of the triangle, the axis of the
+	// box, and the cross product of each axis with each edge
+	vec3 test[13] = { face, axis[0], axis[1], axis[2] };
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			test[4 + i * 3 + j] = Cross(axis[i], edges[j]);
+		}
+	}
+
+	float bestDepth = FLT_MAX;
+	float bestScore = FLT_MAX;
+	vec3 normal;
+	for (int i = 0; i < 13; ++i) {
+		float lengthSq = MagnitudeSq(test[i]);
+		if (lengthSq < 0.000001f) {
+			continue; // Edge is parallel to the axis of the box
+		}
+		vec3 n = test[i] * (1.0f / sqrtf(lengthSq));
+
+		float min = Dot(n, corners[0]);
+		float max = min;
+		for (int j = 1; j < 3; ++j) {
+			float projection = Dot(n, corners[j]);
+			min = fminf(min, projection);
+			max = fmaxf(max, projection);
+		}
+		float center = Dot(n, A.position);
+		float radius = e[0] * fabsf(Dot(axis[0], n)) + e[1] * fabsf(Dot(axis[1], n)) + e[2] * fabsf(Dot(axis[2], n));
+
+		// Push the box back along -n or along +n, whichever is shorter
+		float forward = center + radius - min;
+		float backward = max - (center - radius);
+		float depth = fminf(forward, backward);
+		if (depth < 0.0f) {
+			return;
+		}
+
+		// Favor the face, then the faces of the box. Edges have to be
+		// clearly better, or a box resting on the face would rock
+		float score = depth * ((i == 0) ? 1.0f : (i < 4) ? 1.05f : 1.1f);
+		if (score < bestScore) {
+			bestScore = score;
+			bestDepth = depth;
+			normal = (forward < backward) ? n : n * -1.0f;
+		}
+	}
+
+	float boxRadius = e[0] * fabsf(Dot(axis[0], normal)) + e[1] * fabsf(Dot(axis[1], normal)) + e[2] * fabsf(Dot(axis[2], normal));
+	float boxFar = Dot(normal, A.position) + boxRadius;
+	float triangleNear = fminf(Dot(normal, B.a), fminf(Dot(normal, B.b), Dot(normal, B.c)));
+	vec3 faceNormal = Normalized(face);
+
+	// Corners of the box that are past the triangle and over its face,
+	// then corners of the triangle that are in the box
+	Point points[11];
+	float depths[11];
+	int numPoints = 0;
+	for (int i = 0; i < 8; ++i) {
+		Point corner = A.position +
+			axis[0] * ((i & 1) ? e[0] : -e[0]) +
+			axis[1] * ((i & 2) ? e[1] : -e[1]) +
+			axis[2] * ((i & 4) ? e[2] : -e[2]);
+		float depth = Dot(normal, corner) - triangleNear;
+		Point projected;
+		if (depth > 0.0f && ProjectOntoTriangle(B, faceNormal, corner, &projected)) {
+			points[numPoints] = corner - normal * (depth * 0.5f);
+			depths[numPoints] = fminf(depth, bestDepth);
+			numPoints += 1;
+		}
+	}
+	for (int i = 0; i < 3; ++i) {
+		float depth = boxFar - Dot(normal, corners[i]);
+		if (depth > 0.0f && PointInOBB(corners[i], A)) {
+			points[numPoints] = corners[i] + normal * (depth * 0.5f);
+			depths[numPoints] = fminf(depth, bestDepth);
+			numPoints += 1;
+		}
+	}
+
+	result->colliding = true;
+	result->normal = normal;
+	result->depth = bestDepth;
+	if (numPoints == 0) {
+		// Edge against edge, the deepest corner is on the box edge
+		Point deepest = A.position;
+		for (int i = 0; i < 3; ++i) {
+			deepest = deepest + axis[i] * ((Dot(axis[i], normal) > 0.0f) ? e[i] : -e[i]);
+		}
+		result->contacts[0] = deepest - normal * (bestDepth * 0.5f);
+		result->depths[0] = bestDepth;
+		result->numContacts = 1;
+	}
+	else {
+		ReduceContacts(result, normal, points, depths, numPoints);
+	}
+}
+
+void FindCollisionFeatures(const Sphere& A, const Sphere& B, CollisionManifold* outResult) {
+	CollisionManifold& result = *outResult;
 	ResetCollisionManifold(&result);
 
 	float r = A.radius + B.radius;
 	vec3 d = B.position - A.position;
 
 	if (MagnitudeSq(d) - r * r > 0 || MagnitudeSq(d) == 0.0f) {
-		return result;
+		return;
 	}
 	Normalize(d);
 
@@ -2298,26 +3197,32 @@ CollisionManifold FindCollisionFeatures(const Sphere& A, const Sphere& B) {
 	float dtp = A.radius - result.depth;
 	Point contact = A.position + d * dtp;
 	
-	result.contacts.push_back(contact);
+	result.contacts[0] = contact;
+	result.depths[0] = result.depth;
+	result.numContacts = 1;
+}
 
+CollisionManifold FindCollisionFeatures(const Sphere& A, const Sphere& B) {
+	CollisionManifold result; // Will return result of intersection!
+	FindCollisionFeatures(A, B, &result);
 	return result;
 }
 
-CollisionManifold FindCollisionFeatures(const OBB& A, const Sphere& B) {
-	CollisionManifold result; // Will return result of intersection!
+void FindCollisionFeatures(const OBB& A, const Sphere& B, CollisionManifold* outResult) {
+	CollisionManifold& result = *outResult;
 	ResetCollisionManifold(&result);
 
 	Point closestPoint = ClosestPoint(A, B.position);
 
 	float distanceSq = MagnitudeSq(closestPoint - B.position);
 	if (distanceSq > B.radius * B.radius) {
-		return result;
+		return;
 	}
 
 	vec3 normal; 
 	if (CMP(distanceSq, 0.0f)) {
 		if (CMP(MagnitudeSq(closestPoint - A.position), 0.0f)) {
-			return result;
+			return;
 
 		}
 		// Closest point is at the center of the sphere
@@ -2332,9 +3237,15 @@ CollisionManifold FindCollisionFeatures(const OBB& A, const Sphere& B) {
 	float distance = Magnitude(closestPoint - outsidePoint);
 
 	result.colliding = true;
-	result.contacts.push_back(closestPoint + (outsidePoint - closestPoint) * 0.5f);
+	result.contacts[0] = closestPoint + (outsidePoint - closestPoint) * 0.5f;
+	result.numContacts = 1;
 	result.normal = normal;
 	result.depth = distance * 0.5f;
+	result.depths[0] = result.depth;
+}
 
+CollisionManifold FindCollisionFeatures(const OBB& A, const Sphere& B) {
+	CollisionManifold result; // Will return result of intersection!
+	FindCollisionFeatures(A, B, &result);
 	return result;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include "vectors.h"
 #include "matrices.h"
+#include "MemoryTracker.h"
 
 #ifndef NO_EXTRAS
 #include <ostream>
@@ -67,6 +68,39 @@ typedef struct OBB {
 		position(p), size(s), orientation(o) { }
 } OBB;
 
+// A sphere swept along a line segment. The segment follows the
+// local Y axis, halfHeight up and down from position
+typedef struct Capsule {
+	Point position;
+	float radius;
+	float halfHeight;
+	mat3 orientation;
+
+	inline Capsule() : radius(0.5f), halfHeight(0.5f) { }
+	inline Capsule(const Point& p, float r, float h) :
+		position(p), radius(r), halfHeight(h) { }
+	inline Capsule(const Point& p, float r, float h, const mat3& o) :
+		position(p), radius(r), halfHeight(h), orientation(o) { }
+} Capsule;
+
+// Vertices are in local space and are not owned by the hull, so
+// many hulls can share them (like a Model shares a Mesh)
+typedef struct ConvexHull {
+	Point position;
+	mat3 orientation;
+	const Point* vertices;
+	int numVertices;
+	// Optional, the neighbours of vertex i are adjacency[adjacencyStart[i]]
+	// up to adjacency[adjacencyStart[i + 1]]. Without them the support
+	// function checks every vertex
+	const int* adjacencyStart;
+	const int* adjacency;
+
+	inline ConvexHull() : vertices(0), numVertices(0), adjacencyStart(0), adjacency(0) { }
+	inline ConvexHull(const Point& p, const Point* v, int n) :
+		position(p), vertices(v), numVertices(n), adjacencyStart(0), adjacency(0) { }
+} ConvexHull;
+
 typedef struct Plane {
 	vec3 normal;
 	float distance;
@@ -76,7 +110,12 @@ typedef struct Plane {
 		normal(n), distance(d) { }
 } Plane;
 
+// GCC and Clang don't allow members with constructors inside of
+// anonymous structs. On those compilers Triangle only has a, b and c
+// and Frustum only has the planes array. The memory layout is the same.
+
 typedef struct Triangle {
+#ifdef _MSC_VER
 	union {
 		struct {
 			Point a;
@@ -94,6 +133,11 @@ typedef struct Triangle {
 		Point points[3];
 		float values[9];
 	};
+#else
+	Point a;
+	Point b;
+	Point c;
+#endif
 	
 	inline Triangle() { }
 	inline Triangle(const Point& _p1, const Point& _p2, const Point& _p3) :
@@ -107,6 +151,7 @@ typedef struct BVHNode {
 	int* triangles;
 
 	BVHNode() : children(0), numTriangles(0), triangles(0) {}
+	TAGGED_NEW_DELETE(MEMORY_TAG_BVH)
 } BVHNode;
 
 typedef struct Mesh {
@@ -148,6 +193,7 @@ typedef struct Interval {
 } Interval;
 
 typedef struct Frustum {
+#ifdef _MSC_VER
 	union {
 		struct {
 			Plane top;
@@ -159,6 +205,9 @@ typedef struct Frustum {
 		};
 		Plane planes[6];
 	};
+#else
+	Plane planes[6]; // top, bottom, left, right, near, far
+#endif
 
 	inline Frustum() { }
 } Frustum;
@@ -235,6 +284,8 @@ Point ClosestPoint(const OBB& obb, const Point& point);
 Point ClosestPoint(const Plane& plane, const Point& point);
 Point ClosestPoint(const Line& line, const Point& point);
 Point ClosestPoint(const Ray& ray, const Point& point);
+// Like the sphere, always a point on the surface
+Point ClosestPoint(const Capsule& capsule, const Point& point);
 
 #ifndef NO_EXTRAS
 Point ClosestPoint(const Point& point, const Sphere& sphere);
@@ -243,6 +294,7 @@ Point ClosestPoint(const Point& point, const OBB& obb);
 Point ClosestPoint(const Point& point, const Plane& plane);
 Point ClosestPoint(const Point& point, const Line& line);
 Point ClosestPoint(const Point& point, const Ray& ray);
+Point ClosestPoint(const Point& point, const Capsule& capsule);
 Point ClosestPoint(const Point& p, const Triangle& t);
 #endif
 
@@ -264,6 +316,9 @@ bool AABBAABB(const AABB& aabb1, const AABB& aabb2);
 bool AABBOBB(const AABB& aabb, const OBB& obb);
 bool AABBPlane(const AABB& aabb, const Plane& plane);
 bool OBBOBB(const OBB& obb1, const OBB& obb2);
+// Same test as OBBOBB. If the boxes overlap, also finds the axis of
+// least penetration (pointing from obb1 to obb2) and the depth along it
+bool OBBOBBPenetration(const OBB& obb1, const OBB& obb2, vec3* outNormal, float* outDepth);
 bool OBBPlane(const OBB& obb, const Plane& plane);
 bool PlanePlane(const Plane& plane1, const Plane& plane2);
 
@@ -285,12 +340,14 @@ bool Raycast(const AABB& aabb, const Ray& ray, RaycastResult* outResult);
 bool Raycast(const OBB& obb, const Ray& ray, RaycastResult* outResult);
 bool Raycast(const Plane& plane, const Ray& ray, RaycastResult* outResult);
 bool Raycast(const Triangle& triangle, const Ray& ray, RaycastResult* outResult);
+bool Raycast(const Capsule& capsule, const Ray& ray, RaycastResult* outResult);
 
 bool Linetest(const Sphere& sphere, const Line& line);
 bool Linetest(const AABB& aabb, const Line& line);
 bool Linetest(const OBB& obb, const Line& line);
 bool Linetest(const Plane& plane, const Line& line);
 bool Linetest(const Triangle& triangle, const Line& line);
+bool Linetest(const Capsule& capsule, const Line& line);
 
 #ifndef NO_EXTRAS
 bool Raycast(const Ray& ray, const Sphere& sphere, RaycastResult* outResult);
@@ -301,6 +358,8 @@ bool Linetest(const Line& line, const Sphere& sphere);
 bool Linetest(const Line& line, const AABB& aabb);
 bool Linetest(const Line& line, const OBB& obb);
 bool Linetest(const Line& line, const Plane& plane);
+bool Raycast(const Ray& ray, const Capsule& capsule, RaycastResult* outResult);
+bool Linetest(const Line& line, const Capsule& capsule);
 #endif
 
 #ifndef NO_EXTRAS
@@ -374,20 +433,54 @@ Ray GetPickRay(const vec2& viewportPoint, const vec2& viewportOrigin, const vec2
 
 // Chapter 15
 
+// Contacts are stored inline, so a manifold can be reset, filled
+// and copied without touching the heap
+#ifndef MAX_MANIFOLD_CONTACTS
+#define MAX_MANIFOLD_CONTACTS 8
+#endif
+
 typedef struct CollisionManifold {
 	bool colliding;
 	vec3 normal;
 	float depth;
-	std::vector<vec3> contacts;
+	vec3 contacts[MAX_MANIFOLD_CONTACTS];
+	float depths[MAX_MANIFOLD_CONTACTS]; // Penetration at each contact
+	int numContacts;
 };
 void ResetCollisionManifold(CollisionManifold* result);
 
+// Array versions don't allocate, the vector versions wrap them
+void GetVertices(const OBB& obb, Point outVertices[8]);
+void GetEdges(const OBB& obb, Line outEdges[12]);
+void GetPlanes(const OBB& obb, Plane outPlanes[6]);
 std::vector<Point> GetVertices(const OBB& obb);
 std::vector<Line> GetEdges(const OBB& obb);
 std::vector<Plane> GetPlanes(const OBB& obb);
 bool ClipToPlane(const Plane& plane, const Line& line, Point* outPoint);
+// Returns how many points were written, at most maxPoints
+int ClipEdgesToOBB(const Line* edges, int numEdges, const OBB& obb, Point* outPoints, int maxPoints);
 std::vector<Point> ClipEdgesToOBB(const std::vector<Line>& edges, const OBB& obb);
 float PenetrationDepth(const OBB& o1, const OBB& o2, const vec3& axis, bool* outShouldFlip);
+// Replaces the contacts of result with at most 4 of the candidates,
+// the deepest one and the ones that span the largest area
+void ReduceContacts(CollisionManifold* result, const vec3& normal, const Point* points, const float* depths, int numPoints);
+
+// Write into a manifold owned by the caller, result is reset first
+void FindCollisionFeatures(const Sphere& A, const Sphere& B, CollisionManifold* result);
+void FindCollisionFeatures(const OBB& A, const Sphere& B, CollisionManifold* result);
+void FindCollisionFeatures(const OBB& A, const OBB& B, CollisionManifold* result);
+
+// Capsules have their own tests, they are much cheaper than box-box.
+// The normal points from the capsule to the other shape
+void FindCollisionFeatures(const Capsule& A, const Sphere& B, CollisionManifold* result);
+void FindCollisionFeatures(const Capsule& A, const Capsule& B, CollisionManifold* result);
+void FindCollisionFeatures(const Capsule& A, const OBB& B, CollisionManifold* result);
+
+// Triangles are two sided, the normal points from the shape to the
+// triangle. Used against static meshes, see MeshCollider.h
+void FindCollisionFeatures(const Sphere& A, const Triangle& B, CollisionManifold* result);
+void FindCollisionFeatures(const Capsule& A, const Triangle& B, CollisionManifold* result);
+void FindCollisionFeatures(const OBB& A, const Triangle& B, CollisionManifold* result);
 
 CollisionManifold FindCollisionFeatures(const Sphere& A, const Sphere& B);
 CollisionManifold FindCollisionFeatures(const OBB& A, const Sphere& B);
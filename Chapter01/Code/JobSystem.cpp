@@ -0,0 +1,202 @@
+#include "JobSystem.h"
+#include "Tracer.h"
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+typedef struct JobQueue {
+	std::mutex lock;
+	std::deque<Job> jobs;
+} JobQueue;
+
+// queues[0] is shared by threads that are not workers, worker i
+// owns queues[i + 1]
+static JobQueue* queues = 0;
+static std::vector<std::thread> workers;
+static int numQueues = 0;
+
+// Workers sleep while nothing is queued
+static std::atomic<int> queuedJobs(0);
+static std::mutex sleepMutex;
+static std::condition_variable sleepCondition;
+static bool stopping = false;
+
+static thread_local int threadQueue = 0;
+
+static void RunJob(const Job& job);
+
+static void QueueJob(const Job& job) {
+	if (numQueues == 0) {
+		RunJob(job);
+		return;
+	}
+
+	JobQueue& queue = queues[threadQueue];
+	{
+		std::lock_guard<std::mutex> lock(queue.lock);
+		queue.jobs.push_back(job);
+	}
+	queuedJobs.fetch_add(1);
+	std::lock_guard<std::mutex> lock(sleepMutex);
+	sleepCondition.notify_one();
+}
+
+// The newest job of this thread, or the oldest one of another thread
+static bool TakeJob(Job* outJob) {
+	if (numQueues == 0 || queuedJobs.load() == 0) {
+		return false;
+	}
+	for (int i = 0; i < numQueues; ++i) {
+		int index = (threadQueue + i) % numQueues;
+		JobQueue& queue = queues[index];
+		std::lock_guard<std::mutex> lock(queue.lock);
+		if (queue.jobs.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			*outJob = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else {
+			*outJob = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+		queuedJobs.fetch_sub(1);
+		return true;
+	}
+	return false;
+}
+
+static void RunJob(const Job& job) {
+	job.function(job.data, job.begin, job.end);
+
+	// Whoever waits on the counter takes the lock before it returns,
+	// so the counter outlives this
+	std::vector<Job> ready;
+	{
+		JobCounter& counter = *job.counter;
+		std::lock_guard<std::mutex> lock(counter.lock);
+		if (counter.pending.fetch_sub(1) == 1) {
+			ready.swap(counter.waiting);
+		}
+	}
+	for (int i = 0, size = ready.size(); i < size; ++i) {
+		QueueJob(ready[i]);
+	}
+}
+
+static void WorkerLoop(int queue) {
+	threadQueue = queue;
+	TraceThreadName("Job Worker");
+
+	Job job;
+	while (true) {
+		if (TakeJob(&job)) {
+			RunJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		while (!stopping && queuedJobs.load() == 0) {
+			sleepCondition.wait(lock);
+		}
+		if (stopping) {
+			return;
+		}
+	}
+}
+
+void StartJobSystem(int numWorkers) {
+	StopJobSystem();
+	if (numWorkers <= 0) {
+		return;
+	}
+
+	stopping = false;
+	numQueues = numWorkers + 1;
+	queues = new JobQueue[numQueues];
+	for (int i = 0; i < numWorkers; ++i) {
+		workers.push_back(std::thread(WorkerLoop, i + 1));
+	}
+}
+
+void StopJobSystem() {
+	if (numQueues == 0) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+		sleepCondition.notify_all();
+	}
+	for (int i = 0, size = workers.size(); i < size; ++i) {
+		workers[i].join();
+	}
+	workers.clear();
+
+	delete[] queues;
+	queues = 0;
+	numQueues = 0;
+	queuedJobs.store(0);
+}
+
+int GetJobWorkerCount() {
+	return (int)workers.size();
+}
+
+int GetDefaultJobWorkerCount() {
+	int hardware = (int)std::thread::hardware_concurrency();
+	return (hardware > 1) ? hardware - 1 : 0;
+}
+
+void AddJob(JobFunction function, void* data, int begin, int end, JobCounter* counter, JobCounter* after) {
+	Job job;
+	job.function = function;
+	job.data = data;
+	job.begin = begin;
+	job.end = end;
+	job.counter = counter;
+	counter->pending.fetch_add(1);
+
+	if (after != 0) {
+		std::lock_guard<std::mutex> lock(after->lock);
+		if (after->pending.load() > 0) {
+			after->waiting.push_back(job);
+			return;
+		}
+	}
+	QueueJob(job);
+}
+
+void WaitForJobs(JobCounter* counter) {
+	Job job;
+	while (counter->pending.load() > 0) {
+		if (TakeJob(&job)) {
+			RunJob(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	// The thread that ran the last job may still hold the lock
+	std::lock_guard<std::mutex> lock(counter->lock);
+}
+
+void ParallelFor(int count, int grainSize, JobFunction function, void* data) {
+	if (grainSize < 1) {
+		grainSize = 1;
+	}
+	if (numQueues == 0 || count <= grainSize) {
+		for (int begin = 0; begin < count; begin += grainSize) {
+			function(data, begin, (begin + grainSize < count) ? begin + grainSize : count);
+		}
+		return;
+	}
+
+	JobCounter counter;
+	for (int begin = 0; begin < count; begin += grainSize) {
+		AddJob(function, data, begin, (begin + grainSize < count) ? begin + grainSize : count, &counter, 0);
+	}
+	WaitForJobs(&counter);
+}
\ No newline at end of file
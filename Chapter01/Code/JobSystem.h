@@ -0,0 +1,58 @@
+#ifndef _H_JOB_SYSTEM_
+#define _H_JOB_SYSTEM_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// A pool of worker threads shared by everything that runs in parallel:
+// the physics system, cloths, scene queries and BVH builds. Nothing
+// else starts threads of it's own, but the physics thread (see
+// PhysicsSystem::StartThread), which adds jobs like any other thread.
+// Every thread has a deque of jobs. It adds and takes jobs at the back
+// of it's own deque, and once that is empty steals from the front of
+// another one. Threads that are not workers share one deque.
+// A thread that waits for jobs runs queued jobs until they are done
+// instead of blocking, so a job can start jobs and wait for them.
+// With 0 workers, which is the default, every job runs inline on the
+// thread that adds it, in the order they were added.
+
+typedef void(*JobFunction)(void* data, int begin, int end);
+
+typedef struct Job {
+	JobFunction function;
+	void* data;
+	int begin;
+	int end;
+	struct JobCounter* counter;
+} Job;
+
+// Counts the jobs added with it that haven't run yet. Jobs can also
+// wait for a counter to reach 0 before they are queued
+typedef struct JobCounter {
+	std::atomic<int> pending;
+	// Taken to change pending to 0 and to add a job that waits on it
+	std::mutex lock;
+	std::vector<Job> waiting; // Queued once pending is 0
+
+	inline JobCounter() : pending(0) { }
+} JobCounter;
+
+// Stops the workers that are running first. Jobs must not be running
+void StartJobSystem(int numWorkers);
+void StopJobSystem();
+int GetJobWorkerCount();
+// One worker for each hardware thread, but the calling one
+int GetDefaultJobWorkerCount();
+
+// Runs function(data, begin, end) on some thread. counter is incremented
+// now and decremented after the job ran. If after is not 0 the job is
+// only queued once after reaches 0
+void AddJob(JobFunction function, void* data, int begin, int end, JobCounter* counter, JobCounter* after);
+// Runs queued jobs until counter reaches 0
+void WaitForJobs(JobCounter* counter);
+// Calls function for [0, count) in ranges of grainSize items, then waits
+// for all of them. The ranges don't depend on the number of workers
+void ParallelFor(int count, int grainSize, JobFunction function, void* data);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every block starts with a header that remembers it's size and
+// tag. 16 bytes, so the memory after it stays 16 byte aligned
+typedef struct AllocationHeader {
+	size_t bytes;
+	int tag;
+	int padding;
+} AllocationHeader;
+
+#define HEADER_SIZE 16
+
+#ifndef NO_MEMORY_TRACKING
+static std::atomic<long long> tagBytes[MEMORY_TAG_COUNT];
+static std::atomic<long long> tagAllocations[MEMORY_TAG_COUNT];
+static std::atomic<long long> tagHighWater[MEMORY_TAG_COUNT];
+static std::atomic<long long> tagTotal[MEMORY_TAG_COUNT];
+// Total allocations when the current frame started, only
+// touched by the thread calling MemoryNewFrame
+static long long frameStart[MEMORY_TAG_COUNT];
+static long long lastFrameAllocations[MEMORY_TAG_COUNT];
+#endif
+
+void* TaggedAlloc(size_t bytes, int tag) {
+	if (tag < 0 || tag >= MEMORY_TAG_COUNT) {
+		tag = MEMORY_TAG_OTHER;
+	}
+
+	char* block = (char*)malloc(bytes + HEADER_SIZE);
+	if (block == 0) {
+		throw std::bad_alloc();
+	}
+	AllocationHeader* header = (AllocationHeader*)block;
+	header->bytes = bytes;
+	header->tag = tag;
+
+#ifndef NO_MEMORY_TRACKING
+	long long current = tagBytes[tag].fetch_add((long long)bytes, std::memory_order_relaxed) + (long long)bytes;
+	tagAllocations[tag].fetch_add(1, std::memory_order_relaxed);
+	tagTotal[tag].fetch_add(1, std::memory_order_relaxed);
+
+	long long highWater = tagHighWater[tag].load(std::memory_order_relaxed);
+	while (current > highWater && !tagHighWater[tag].compare_exchange_weak(highWater, current)) {
+		// highWater was reloaded, try again
+	}
+#endif
+
+	return block + HEADER_SIZE;
+}
+
+void TaggedFree(void* ptr) {
+	if (ptr == 0) {
+		return;
+	}
+	char* block = (char*)ptr - HEADER_SIZE;
+
+#ifndef NO_MEMORY_TRACKING
+	AllocationHeader* header = (AllocationHeader*)block;
+	tagBytes[header->tag].fetch_sub((long long)header->bytes, std::memory_order_relaxed);
+	tagAllocations[header->tag].fetch_sub(1, std::memory_order_relaxed);
+#endif
+
+	free(block);
+}
+
+const char* MemoryTagName(int tag) {
+	static const char* names[MEMORY_TAG_COUNT] = {
+		"Other", "BVH", "Octree", "Manifold", "QuadTree", "Cloth", "Physics"
+	};
+	if (tag < 0 || tag >= MEMORY_TAG_COUNT) {
+		return "Invalid";
+	}
+	return names[tag];
+}
+
+MemoryStats GetMemoryStats(int tag) {
+	MemoryStats result = { 0, 0, 0, 0, 0 };
+#ifndef NO_MEMORY_TRACKING
+	if (tag >= 0 && tag < MEMORY_TAG_COUNT) {
+		result.bytes = tagBytes[tag].load(std::memory_order_relaxed);
+		result.allocations = tagAllocations[tag].load(std::memory_order_relaxed);
+		result.highWater = tagHighWater[tag].load(std::memory_order_relaxed);
+		result.totalAllocations = tagTotal[tag].load(std::memory_order_relaxed);
+		result.frameAllocations = lastFrameAllocations[tag];
+	}
+#endif
+	return result;
+}
+
+void MemoryNewFrame() {
+#ifndef NO_MEMORY_TRACKING
+	for (int i = 0; i < MEMORY_TAG_COUNT; ++i) {
+		long long total = tagTotal[i].load(std::memory_order_relaxed);
+		lastFrameAllocations[i] = total - frameStart[i];
+		frameStart[i] = total;
+	}
+#endif
+}
+
+void WriteMemoryReport(std::ostream& os) {
+	os << "tag,bytes,allocations,high_water_bytes,total_allocations,frame_allocations\n";
+	for (int i = 0; i < MEMORY_TAG_COUNT; ++i) {
+		MemoryStats stats = GetMemoryStats(i);
+		os << MemoryTagName(i) << "," << stats.bytes << "," << stats.allocations << ","
+			<< stats.highWater << "," << stats.totalAllocations << "," << stats.frameAllocations << "\n";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef _H_MEMORY_TRACKER_
+#define _H_MEMORY_TRACKER_
+
+#include <cstddef>
+#include <ostream>
+
+// Memory allocated with TaggedAlloc is counted against a tag, so it
+// can be reported per subsystem. Containers use TaggedAllocator and
+// structs use TAGGED_NEW_DELETE to route through it.
+// If NO_MEMORY_TRACKING is defined, nothing is counted but memory is
+// still allocated through the same functions.
+
+#define MEMORY_TAG_OTHER	0
+#define MEMORY_TAG_BVH		1
+#define MEMORY_TAG_OCTREE	2
+#define MEMORY_TAG_MANIFOLD	3
+#define MEMORY_TAG_QUADTREE	4
+#define MEMORY_TAG_CLOTH	5
+#define MEMORY_TAG_PHYSICS	6
+#define MEMORY_TAG_COUNT	7
+
+typedef struct MemoryStats {
+	long long bytes; // Allocated right now
+	long long allocations; // Live right now
+	long long highWater; // Most bytes allocated at once
+	long long totalAllocations; // Since the program started
+	long long frameAllocations; // During the last frame, see MemoryNewFrame
+} MemoryStats;
+
+void* TaggedAlloc(size_t bytes, int tag);
+void TaggedFree(void* ptr);
+
+const char* MemoryTagName(int tag);
+MemoryStats GetMemoryStats(int tag);
+// Call once per frame, the allocations made since the last call
+// become that tag's frameAllocations
+void MemoryNewFrame();
+void WriteMemoryReport(std::ostream& os);
+
+#define TAGGED_NEW_DELETE(tag) \
+	static inline void* operator new(size_t bytes) { return TaggedAlloc(bytes, tag); } \
+	static inline void* operator new[](size_t bytes) { return TaggedAlloc(bytes, tag); } \
+	static inline void operator delete(void* ptr) { TaggedFree(ptr); } \
+	static inline void operator delete[](void* ptr) { TaggedFree(ptr); }
+
+template<typename T, int Tag>
+class TaggedAllocator {
+public:
+	typedef T value_type;
+	template<typename U>
+	struct rebind {
+		typedef TaggedAllocator<U, Tag> other;
+	};
+
+	inline TaggedAllocator() { }
+	template<typename U>
+	inline TaggedAllocator(const TaggedAllocator<U, Tag>&) { }
+
+	inline T* allocate(size_t count) {
+		return (T*)TaggedAlloc(count * sizeof(T), Tag);
+	}
+	inline void deallocate(T* ptr, size_t) {
+		TaggedFree(ptr);
+	}
+};
+
+template<typename T, typename U, int Tag>
+inline bool operator==(const TaggedAllocator<T, Tag>&, const TaggedAllocator<U, Tag>&) {
+	return true;
+}
+
+template<typename T, typename U, int Tag>
+inline bool operator!=(const TaggedAllocator<T, Tag>&, const TaggedAllocator<U, Tag>&) {
+	return false;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "MeshCollider.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+// Neighbours that bend by less than about 5 degrees are flat
+#define MESH_FLAT_COS 0.996f
+// Normals closer than this to the face are on the face
+#define MESH_FACE_COS 0.9998f
+// Contacts whose normals are closer than this share a manifold
+#define MESH_MERGE_COS 0.95f
+#define MESH_GROUP_CONTACTS 32
+// How close a speculative contact sweep gets to the mesh
+#define MESH_SPECULATIVE_TOLERANCE 0.001f
+
+// Both corners of an edge, the smaller one first, so the two
+// triangles on an edge make the same key no matter their winding
+typedef struct EdgeKey {
+	float v[6];
+
+	inline bool operator<(const EdgeKey& other) const {
+		return std::lexicographical_compare(v, v + 6, other.v, other.v + 6);
+	}
+} EdgeKey;
+
+static EdgeKey MakeEdgeKey(const Point& p, const Point& q) {
+	bool swap = std::lexicographical_compare(q.asArray, q.asArray + 3, p.asArray, p.asArray + 3);
+	const Point& first = swap ? q : p;
+	const Point& second = swap ? p : q;
+	EdgeKey key;
+	for (int i = 0; i < 3; ++i) {
+		key.v[i] = first.asArray[i];
+		key.v[3 + i] = second.asArray[i];
+	}
+	return key;
+}
+
+// Unit direction from the edge pq to the corner opposite of it
+static vec3 AwayFromEdge(const Point& p, const Point& q, const Point& opposite) {
+	vec3 edge = q - p;
+	vec3 toCorner = opposite - p;
+	float edgeSq = MagnitudeSq(edge);
+	if (edgeSq > 0.0f) {
+		toCorner = toCorner - edge * (Dot(toCorner, edge) / edgeSq);
+	}
+	float lengthSq = MagnitudeSq(toCorner);
+	return (lengthSq > 0.0f) ? toCorner * (1.0f / sqrtf(lengthSq)) : toCorner;
+}
+
+void BuildMeshCollider(Model* model, MeshCollider* outCollider) {
+	outCollider->model = model;
+	outCollider->activeEdges.clear();
+	Mesh* mesh = (model != 0) ? model->GetMesh() : 0;
+	if (mesh == 0 || mesh->numTriangles == 0) {
+		return;
+	}
+	AccelerateMesh(*mesh);
+
+	// Every edge is active until a flat neighbour is found for it
+	outCollider->activeEdges.assign(mesh->numTriangles, TRIANGLE_EDGE_AB | TRIANGLE_EDGE_BC | TRIANGLE_EDGE_CA);
+
+	// Triangles only share corners by position, find the triangles on
+	// each edge. Values are triangle * 3 + edge
+	std::map<EdgeKey, std::vector<int> > edges;
+	for (int i = 0; i < mesh->numTriangles; ++i) {
+		const Point* corners = &mesh->vertices[i * 3];
+		for (int j = 0; j < 3; ++j) {
+			edges[MakeEdgeKey(corners[j], corners[(j + 1) % 3])].push_back(i * 3 + j);
+		}
+	}
+
+	for (std::map<EdgeKey, std::vector<int> >::iterator it = edges.begin(); it != edges.end(); ++it) {
+		const std::vector<int>& users = it->second;
+		if (users.size() != 2) {
+			continue; // Border, or more than two triangles on one edge
+		}
+
+		// Flat if the corners opposite of the edge point away from
+		// it in about opposite directions. Works with any winding
+		vec3 away[2];
+		for (int k = 0; k < 2; ++k) {
+			const Point* corners = &mesh->vertices[(users[k] / 3) * 3];
+			int edge = users[k] % 3;
+			away[k] = AwayFromEdge(corners[edge], corners[(edge + 1) % 3], corners[(edge + 2) % 3]);
+		}
+		if (Dot(away[0], away[1]) < -MESH_FLAT_COS) {
+			for (int k = 0; k < 2; ++k) {
+				outCollider->activeEdges[users[k] / 3] &= ~(1 << (users[k] % 3));
+			}
+		}
+	}
+}
+
+// Indices of the triangles whose bounds overlap min to max. Triangles
+// that are in more than one node of the BVH are only written once
+static int GatherTriangles(const Mesh& mesh, const vec3& min, const vec3& max, int* outTriangles, int maxTriangles) {
+	int numTriangles = 0;
+	if (mesh.accelerator == 0) {
+		for (int i = 0; i < mesh.numTriangles && numTriangles < maxTriangles; ++i) {
+			outTriangles[numTriangles++] = i;
+		}
+		return numTriangles;
+	}
+
+	const BVHNode* stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = mesh.accelerator;
+	AABB bounds = FromMinMax(min, max);
+	while (stackSize > 0) {
+		const BVHNode* node = stack[--stackSize];
+		if (!AABBAABB(node->bounds, bounds)) {
+			continue;
+		}
+
+		for (int i = 0; i < node->numTriangles; ++i) {
+			int index = node->triangles[i];
+			const Triangle& t = mesh.triangles[index];
+			if (fminf(t.a.x, fminf(t.b.x, t.c.x)) > max.x || fmaxf(t.a.x, fmaxf(t.b.x, t.c.x)) < min.x ||
+				fminf(t.a.y, fminf(t.b.y, t.c.y)) > max.y || fmaxf(t.a.y, fmaxf(t.b.y, t.c.y)) < min.y ||
+				fminf(t.a.z, fminf(t.b.z, t.c.z)) > max.z || fmaxf(t.a.z, fmaxf(t.b.z, t.c.z)) < min.z) {
+				continue;
+			}
+
+			bool duplicate = false;
+			for (int j = 0; j < numTriangles; ++j) {
+				if (outTriangles[j] == index) {
+					duplicate = true;
+					break;
+				}
+			}
+			if (!duplicate) {
+				if (numTriangles == maxTriangles) {
+					return numTriangles;
+				}
+				outTriangles[numTriangles++] = index;
+			}
+		}
+
+		if (node->children != 0) {
+			for (int i = 0; i < 8 && stackSize < 64; ++i) {
+				stack[stackSize++] = &node->children[i];
+			}
+		}
+	}
+
+	return numTriangles;
+}
+
+// A shape moved into the space of a model
+typedef struct LocalShape {
+	Sphere sphere;
+	OBB box;
+	Capsule capsule;
+	ConvexShape shape;
+	vec3 extents; // Half size of the box around the shape
+} LocalShape;
+
+static void ToModelSpace(const ConvexShape& shape, const mat4& inv, LocalShape* out) {
+	mat3 rotation = Cut(inv, 3, 3);
+	if (shape.type == SHAPE_TYPE_SPHERE) {
+		out->sphere = Sphere(MultiplyPoint(shape.sphere->position, inv), shape.sphere->radius);
+		out->shape = ConvexShape(out->sphere);
+		out->extents = vec3(out->sphere.radius, out->sphere.radius, out->sphere.radius);
+	}
+	else if (shape.type == SHAPE_TYPE_OBB) {
+		out->box = OBB(MultiplyPoint(shape.obb->position, inv), shape.obb->size, shape.obb->orientation * rotation);
+		out->shape = ConvexShape(out->box);
+		const float* o = out->box.orientation.asArray;
+		const vec3& size = out->box.size;
+		for (int i = 0; i < 3; ++i) {
+			out->extents[i] = size.x * fabsf(o[i]) + size.y * fabsf(o[3 + i]) + size.z * fabsf(o[6 + i]);
+		}
+	}
+	else {
+		out->capsule = Capsule(MultiplyPoint(shape.capsule->position, inv), shape.capsule->radius,
+			shape.capsule->halfHeight, shape.capsule->orientation * rotation);
+		out->shape = ConvexShape(out->capsule);
+		const float* up = &out->capsule.orientation.asArray[3];
+		for (int i = 0; i < 3; ++i) {
+			out->extents[i] = fabsf(up[i]) * out->capsule.halfHeight + out->capsule.radius;
+		}
+	}
+}
+
+// Contacts with about the same normal, merged into one manifold
+typedef struct ContactGroup {
+	vec3 normal;
+	float depth;
+	Point points[MESH_GROUP_CONTACTS];
+	float depths[MESH_GROUP_CONTACTS];
+	int numPoints;
+} ContactGroup;
+
+int FindCollisionFeatures(const ConvexShape& shape, const MeshCollider& mesh, CollisionManifold* outManifolds, int maxManifolds) {
+	if (mesh.model == 0 || mesh.model->GetMesh() == 0 || shape.type == SHAPE_TYPE_HULL) {
+		return 0;
+	}
+	const Mesh& triangles = *mesh.model->GetMesh();
+
+	// The triangles are in the space of the model, move the shape there
+	mat4 world = GetWorldMatrix(*mesh.model);
+	mat4 inv = Inverse(world);
+	LocalShape local;
+	ToModelSpace(shape, inv, &local);
+	Point center = GetCenter(local.shape);
+
+	int candidates[MAX_MESH_TRIANGLES];
+	int numCandidates = GatherTriangles(triangles, center - local.extents, center + local.extents, candidates, MAX_MESH_TRIANGLES);
+
+	ContactGroup groups[MESH_MAX_MANIFOLDS];
+	int numGroups = 0;
+	if (maxManifolds > MESH_MAX_MANIFOLDS) {
+		maxManifolds = MESH_MAX_MANIFOLDS;
+	}
+
+	CollisionManifold m;
+	for (int i = 0; i < numCandidates; ++i) {
+		int index = candidates[i];
+		const Triangle& t = triangles.triangles[index];
+		if (shape.type == SHAPE_TYPE_SPHERE) {
+			FindCollisionFeatures(local.sphere, t, &m);
+		}
+		else if (shape.type == SHAPE_TYPE_OBB) {
+			FindCollisionFeatures(local.box, t, &m);
+		}
+		else {
+			FindCollisionFeatures(local.capsule, t, &m);
+		}
+		if (!m.colliding) {
+			continue;
+		}
+
+		vec3 face = Cross(t.b - t.a, t.c - t.a);
+		if (MagnitudeSq(face) < 0.0000001f) {
+			continue;
+		}
+		face = Normalized(face);
+		if (Dot(face, center - t.a) > 0.0f) {
+			face = face * -1.0f; // From the shape into the triangle
+		}
+
+		if (Dot(m.normal, face) < MESH_FACE_COS) {
+			// The contact is on an edge or a corner, the ones that are
+			// nearest to the shape along the normal
+			const Point corners[] = { t.a, t.b, t.c };
+			float along[3];
+			for (int k = 0; k < 3; ++k) {
+				along[k] = Dot(m.normal, corners[k]);
+			}
+			float nearest = fminf(along[0], fminf(along[1], along[2]));
+			int touching[3];
+			int numTouching = 0;
+			for (int k = 0; k < 3; ++k) {
+				if (along[k] <= nearest + 0.001f) {
+					touching[numTouching++] = k;
+				}
+			}
+
+			// Edge k goes from corner k to corner k + 1
+			int edges = 0;
+			if (numTouching == 1) {
+				int k = touching[0];
+				edges = (1 << k) | (1 << ((k + 2) % 3)); // Both edges on the corner
+			}
+			else if (numTouching == 2) {
+				int k = touching[0], j = touching[1];
+				edges = 1 << ((j == k + 1) ? k : 2);
+			}
+			bool active = (mesh.activeEdges[index] & edges) != 0;
+
+			if (!active) {
+				// The neighbour is flat, act as if the face went on
+				float depth = Dot(face, Support(local.shape, face)) - Dot(face, t.a);
+				if (depth <= 0.0f) {
+					continue; // Only touches the edge from the side
+				}
+				m.normal = face;
+				m.depth = depth;
+				for (int k = 0; k < m.numContacts; ++k) {
+					m.depths[k] = depth;
+				}
+			}
+		}
+
+		// Back to world space, into the group with the same normal
+		vec3 normal = Normalized(MultiplyVector(m.normal, world));
+		int group = -1;
+		float closest = -2.0f;
+		for (int k = 0; k < numGroups; ++k) {
+			float alignment = Dot(groups[k].normal, normal);
+			if (alignment > closest) {
+				closest = alignment;
+				group = k;
+			}
+		}
+		if (closest < MESH_MERGE_COS && numGroups < maxManifolds) {
+			group = numGroups++;
+			groups[group].normal = normal;
+			groups[group].depth = 0.0f;
+			groups[group].numPoints = 0;
+		}
+		if (group == -1) {
+			break; // maxManifolds is 0
+		}
+
+		ContactGroup& g = groups[group];
+		g.depth = fmaxf(g.depth, m.depth);
+		for (int k = 0; k < m.numContacts && g.numPoints < MESH_GROUP_CONTACTS; ++k) {
+			g.points[g.numPoints] = MultiplyPoint(m.contacts[k], world);
+			g.depths[g.numPoints] = m.depths[k];
+			g.numPoints += 1;
+		}
+	}
+
+	for (int i = 0; i < numGroups; ++i) {
+		const ContactGroup& g = groups[i];
+		CollisionManifold* result = &outManifolds[i];
+		ResetCollisionManifold(result);
+		result->colliding = true;
+		result->normal = g.normal;
+		result->depth = g.depth;
+		ReduceContacts(result, g.normal, g.points, g.depths, g.numPoints);
+	}
+
+	return numGroups;
+}
+
+float TimeOfImpact(const ConvexShape& shape, const vec3& motion, const MeshCollider& mesh, float tolerance, vec3* outNormal, Point* outPoint) {
+	if (mesh.model == 0 || mesh.model->GetMesh() == 0 || shape.type == SHAPE_TYPE_HULL) {
+		return 1.0f;
+	}
+	const Mesh& triangles = *mesh.model->GetMesh();
+
+	mat4 world = GetWorldMatrix(*mesh.model);
+	mat4 inv = Inverse(world);
+	LocalShape local;
+	ToModelSpace(shape, inv, &local);
+	vec3 localMotion = MultiplyVector(motion, inv);
+
+	// Triangles near any point along the motion
+	Point start = GetCenter(local.shape);
+	Point end = start + localMotion;
+	vec3 margin = local.extents + vec3(tolerance, tolerance, tolerance);
+	vec3 min(fminf(start.x, end.x), fminf(start.y, end.y), fminf(start.z, end.z));
+	vec3 max(fmaxf(start.x, end.x), fmaxf(start.y, end.y), fmaxf(start.z, end.z));
+	int candidates[MAX_MESH_TRIANGLES];
+	int numCandidates = GatherTriangles(triangles, min - margin, max + margin, candidates, MAX_MESH_TRIANGLES);
+
+	float first = 1.0f;
+	for (int i = 0; i < numCandidates; ++i) {
+		const Triangle& t = triangles.triangles[candidates[i]];
+		Point corners[] = { t.a, t.b, t.c };
+		ConvexHull hull(Point(), corners, 3);
+		vec3 normal;
+		Point point;
+		float hit = TimeOfImpact(local.shape, localMotion, ConvexShape(hull), tolerance, &normal, &point);
+		if (hit < first) {
+			first = hit;
+			if (outNormal != 0) {
+				*outNormal = Normalized(MultiplyVector(normal, world));
+			}
+			if (outPoint != 0) {
+				*outPoint = MultiplyPoint(point, world);
+			}
+		}
+	}
+	return first;
+}
+
+void FindSpeculativeFeatures(const ConvexShape& shape, const vec3& motion, const MeshCollider& mesh, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+	vec3 normal;
+	Point point;
+	float hit = TimeOfImpact(shape, motion, mesh, MESH_SPECULATIVE_TOLERANCE, &normal, &point);
+	if (hit >= 1.0f) {
+		return;
+	}
+
+	// At the impact the shape is within tolerance of the mesh
+	float gap = Dot(motion * hit, normal) + MESH_SPECULATIVE_TOLERANCE;
+	if (gap <= 0.0f) {
+		return;
+	}
+	result->colliding = true;
+	result->normal = normal;
+	result->depth = -gap;
+	// On the contact plane in front of the center, an impulse on the
+	// point that hits first would spin the shape before it touches
+	Point center = GetCenter(shape);
+	result->contacts[0] = center + normal * Dot(point - motion * hit - center, normal);
+	result->depths[0] = -gap;
+	result->numContacts = 1;
+}
\ No newline at end of file
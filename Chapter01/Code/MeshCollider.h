@@ -0,0 +1,58 @@
+#ifndef _H_MESH_COLLIDER_
+#define _H_MESH_COLLIDER_
+
+#include "Geometry3D.h"
+#include "GJK.h"
+#include <vector>
+
+// A static triangle mesh that rigid bodies collide with. The candidate
+// triangles for a shape come from the BVH of the mesh, each one is
+// tested with the triangle tests in Geometry3D.
+//
+// A shape sliding over a flat mesh would catch on the edges between
+// triangles, the closest point is on the edge and the normal leans
+// away from the face. Edges where the mesh is flat are marked as
+// inactive, a contact on one of them uses the face normal instead.
+
+// Bits of activeEdges, edge ab is between the a and b corners
+#define TRIANGLE_EDGE_AB	1
+#define TRIANGLE_EDGE_BC	2
+#define TRIANGLE_EDGE_CA	4
+
+// At most this many triangles are tested against one shape
+#ifndef MAX_MESH_TRIANGLES
+#define MAX_MESH_TRIANGLES 256
+#endif
+
+// At most this many manifolds come out of one shape against one mesh
+#define MESH_MAX_MANIFOLDS 8
+
+typedef struct MeshCollider {
+	Model* model; // Not owned
+	// One byte per triangle, an edge is active if it's on the border
+	// of the mesh or if the two triangles on it are not flat
+	std::vector<unsigned char> activeEdges;
+
+	inline MeshCollider() : model(0) { }
+} MeshCollider;
+
+// Finds the active edges, and builds the BVH if the mesh has none
+void BuildMeshCollider(Model* model, MeshCollider* outCollider);
+
+// Contacts of the shape against the mesh. Contacts with about the same
+// normal go in the same manifold, so a box on a flat floor gets one
+// manifold no matter how many triangles it is on. The normal points
+// from the shape to the mesh. Returns how many manifolds were written,
+// at most maxManifolds. Hulls are not supported, they never collide.
+int FindCollisionFeatures(const ConvexShape& shape, const MeshCollider& mesh, CollisionManifold* outManifolds, int maxManifolds);
+
+// TimeOfImpact (see GJK.h) against the closest triangle of the mesh
+float TimeOfImpact(const ConvexShape& shape, const vec3& motion, const MeshCollider& mesh, float tolerance, vec3* outNormal, Point* outPoint);
+
+// A single speculative contact (see UseSpeculativeContacts in
+// PhysicsSystem.h) where the shape would first touch the mesh if it
+// moved along motion. The depth is minus the gap along the normal. Not
+// colliding if it doesn't get there
+void FindSpeculativeFeatures(const ConvexShape& shape, const vec3& motion, const MeshCollider& mesh, CollisionManifold* result);
+
+#endif
\ No newline at end of file
@@ -1,6 +1,5 @@
 #include "Particle.h"
 #include "Geometry3D.h"
-#include "FixedFunctionPrimitives.h"
 
 Particle::Particle() {
 	type = RIGIDBODY_TYPE_PARTICLE;
@@ -33,11 +32,6 @@ void Particle::Update(float deltaTime) {
 #endif
 }
 
-void Particle::Render() {
-	Sphere visual(position, 0.1f);
-	::Render(visual);
-}
-
 void Particle::ApplyForces() {
 #ifdef EULER_INTEGRATION
 	forces = gravity *mass;
@@ -46,34 +40,56 @@ void Particle::ApplyForces() {
 #endif
 }
 
-void Particle::SolveConstraints(const std::vector<OBB>& constraints) {
-	int size = constraints.size();
-	for (int i = 0; i < size; ++i) {
-		Line traveled(oldPosition, position);
-		if (Linetest(constraints[i], traveled)) {
-			//if (PointInOBB(position, constraints[i])) {
+bool Particle::SolveConstraint(const OBB& constraint) {
+	Line traveled(oldPosition, position);
+	if (Linetest(constraint, traveled)) {
+		//if (PointInOBB(position, constraint)) {
 #ifndef EULER_INTEGRATION
-			vec3 velocity = position - oldPosition;
+		vec3 velocity = position - oldPosition;
 #endif
-			vec3 direction = Normalized(velocity);
-			Ray ray(oldPosition, direction);
-			RaycastResult result;
+		vec3 direction = Normalized(velocity);
+		Ray ray(oldPosition, direction);
+		RaycastResult result;
 
-			if (Raycast(constraints[i], ray, &result)) {
-				// Place object just a little above collision result
-				position = result.point + result.normal * 0.003f;
+		if (Raycast(constraint, ray, &result)) {
+			// Place object just a little above collision result
+			position = result.point + result.normal * 0.003f;
 
-				vec3 vn = result.normal * Dot(result.normal, velocity);
-				vec3 vt = velocity - vn;
+			vec3 vn = result.normal * Dot(result.normal, velocity);
+			vec3 vt = velocity - vn;
 
 #ifdef EULER_INTEGRATION
-				oldPosition = position;
-				velocity = vt - vn * bounce;
+			oldPosition = position;
+			velocity = vt - vn * bounce;
 #else
-				oldPosition = position - (vt - vn * bounce);
+			oldPosition = position - (vt - vn * bounce);
 #endif
-				break;
-			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void Particle::SolveConstraints(const std::vector<OBB>& constraints) {
+	int size = constraints.size();
+	for (int i = 0; i < size; ++i) {
+		if (SolveConstraint(constraints[i])) {
+			break;
+		}
+	}
+}
+
+void Particle::SolveConstraints(const ConstraintWorld& world) {
+	int candidates[MAX_CONSTRAINT_CANDIDATES];
+	int numCandidates = QueryConstraintWorld(world, Line(oldPosition, position), candidates, MAX_CONSTRAINT_CANDIDATES);
+	if (numCandidates > MAX_CONSTRAINT_CANDIDATES) {
+		SolveConstraints(world.boxes);
+		return;
+	}
+
+	for (int i = 0; i < numCandidates; ++i) {
+		if (SolveConstraint(world.boxes[candidates[i]])) {
+			break;
 		}
 	}
 }
@@ -27,13 +27,19 @@ class Particle : public Rigidbody {
 	vec3 velocity;
 #endif
 	float mass;
+protected:
+	// True if the particle hit the box and was moved out of it
+	bool SolveConstraint(const OBB& constraint);
 public:
 	Particle();
 
 	void Update(float deltaTime);
+#ifndef NO_RENDER
 	void Render();
+#endif
 	void ApplyForces();
 	void SolveConstraints(const std::vector<OBB>& constraints);
+	void SolveConstraints(const ConstraintWorld& world);
 
 	void SetPosition(const vec3& pos);
 	vec3 GetPosition();
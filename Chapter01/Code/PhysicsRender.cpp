@@ -0,0 +1,314 @@
+#include "PhysicsSystem.h"
+#include "DistanceJoint.h"
+#include "FixedFunctionPrimitives.h"
+#include "glad/glad.h"
+
+// Rendering for the simulation classes. Kept out of the simulation
+// sources so they build without OpenGL, see NO_RENDER in Rigidbody.h
+
+// A copy of the shape of body, transforms are set by the caller
+static void CopyShape(const RigidbodyVolume& body, RigidbodyVolume* outVolume) {
+	outVolume->type = body.type;
+	outVolume->box.size = body.box.size;
+	outVolume->sphere.radius = body.sphere.radius;
+	outVolume->capsule.radius = body.capsule.radius;
+	outVolume->capsule.halfHeight = body.capsule.halfHeight;
+	outVolume->hullMesh = body.hullMesh;
+}
+
+// A copy of body, where it would be between the two steps of the
+// snapshot. Nothing else of body is read, the physics thread is
+// writing it
+static void SnapshotVolume(const RigidbodyVolume& body, const PhysicsSnapshot& snapshot, int index, float alpha, RigidbodyVolume* outVolume) {
+	CopyShape(body, outVolume);
+	outVolume->position = snapshot.prevPositions[index] + (snapshot.positions[index] - snapshot.prevPositions[index]) * alpha;
+#ifndef LINEAR_ONLY
+	outVolume->orientation = Nlerp(snapshot.prevOrientations[index], snapshot.orientations[index], alpha);
+#endif
+	outVolume->SynchCollisionVolumes();
+}
+
+void PhysicsSystem::Render() {
+	// With the physics thread, volume bodies come from the latest
+	// snapshot. If the bodies changed since, they are skipped until
+	// the next one. The rest waits for the step in progress
+	const PhysicsSnapshot* snapshot = 0;
+	float snapshotAlpha = 1.0f;
+	std::unique_lock<std::mutex> lock(stepMutex, std::defer_lock);
+	if (threadRunning.load()) {
+		snapshot = &GetSnapshot();
+		snapshotAlpha = InterpolationAlpha();
+		if (bodies.size() != storageBodies.size() || !springs.empty() || !cloths.empty() || DebugRender) {
+			lock.lock();
+		}
+	}
+	bool snapshotValid = snapshot != 0 && snapshot->bodiesVersion == bodiesVersion;
+
+	// In fixed step mode volume bodies are drawn where they would be
+	// between the last two steps, as copies like the snapshot ones
+	bool interpolate = FixedTimeStep > 0.0f && snapshot == 0;
+	float alpha = interpolate ? InterpolationAlpha() : snapshotAlpha;
+
+	if (DebugRender) {
+		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	}
+	static const float rigidbodyDiffuse[]{ 200.0f / 255.0f, 0.0f, 0.0f, 0.0f };
+	static const float rigidbodyAmbient[]{ 200.0f / 255.0f, 50.0f / 255.0f, 50.0f / 255.0f, 0.0f };
+
+	static const float groundDiffuse[]{ 0.0f, 0.0f, 200.0f / 255.0f, 0.0f };
+	static const float groundAmbient[]{ 50.0f / 255.0f, 50.0f / 255.0f, 200.0f / 255.0f, 0.0f };
+
+	static const float constraintDiffuse[]{ 0.0f, 200.0f / 255.0f, 0.0f, 0.0f };
+	static const float constraintAmbient[]{ 50.0f / 255.0f, 200.0f / 255.0f, 50.0f / 255.0f, 0.0f };
+	
+	static const float zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	std::vector<const float*> ambient;
+	std::vector<const float*> diffuse;
+	if (RenderRandomColors) {
+		ambient.push_back(rigidbodyAmbient);
+		ambient.push_back(groundAmbient);
+		ambient.push_back(constraintAmbient);
+		diffuse.push_back(rigidbodyDiffuse);
+		diffuse.push_back(groundDiffuse);
+		diffuse.push_back(constraintDiffuse);
+	}
+
+	glColor3f(rigidbodyDiffuse[0], rigidbodyDiffuse[1], rigidbodyDiffuse[2]);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, rigidbodyAmbient);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, rigidbodyDiffuse);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
+	for (int i = 0, volume = 0, size = bodies.size(); i < size; ++i) {
+		if (RenderRandomColors) {
+			int a_i = i % ambient.size();
+			int d_i = i % diffuse.size();
+			glColor3f(diffuse[d_i][0], diffuse[d_i][1], diffuse[d_i][2]);
+			glLightfv(GL_LIGHT0, GL_AMBIENT, ambient[a_i]);
+			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse[d_i]);
+			glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
+		}
+		if ((snapshot != 0 || interpolate) && bodies[i]->HasVolume()) {
+			// Volume bodies are in storageBodies in the same order
+			int index = volume++;
+			RigidbodyVolume visual;
+			if (snapshot != 0) {
+				if (!snapshotValid) {
+					continue;
+				}
+				SnapshotVolume(*storageBodies[index], *snapshot, index, alpha, &visual);
+			}
+			else {
+				RigidbodyVolume* body = storageBodies[index];
+				CopyShape(*body, &visual);
+				visual.position = prevPositions[index] + (body->position - prevPositions[index]) * alpha;
+#ifndef LINEAR_ONLY
+				visual.orientation = Nlerp(prevOrientations[index], body->orientation, alpha);
+#endif
+				visual.SynchCollisionVolumes();
+			}
+			if (DebugRender && visual.type == RIGIDBODY_TYPE_BOX) {
+				::Render(GetEdges(visual.box));
+			}
+			else {
+				visual.Render();
+			}
+		}
+		else if (DebugRender && bodies[i]->type == RIGIDBODY_TYPE_BOX) {
+			RigidbodyVolume* mb = (RigidbodyVolume*)bodies[i];
+			mb->SynchCollisionVolumes();
+			::Render(GetEdges(mb->box));
+		}
+		else {
+			bodies[i]->Render();
+		}
+	}
+
+	// First constraint is usually the ground
+	// Rendering it diferent color is just a hack to make visualization easyer
+	// Normally, you wouldn't even render physics geo!
+	if (constraints.size() > 0) {
+		glColor3f(groundDiffuse[0], groundDiffuse[1], groundDiffuse[2]);
+		glLightfv(GL_LIGHT0, GL_AMBIENT, groundAmbient);
+		glLightfv(GL_LIGHT0, GL_DIFFUSE, groundDiffuse);
+		glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
+		::Render(constraints[0]);
+	}
+
+	glColor3f(constraintDiffuse[0], constraintDiffuse[1], constraintDiffuse[2]);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, constraintAmbient);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, constraintDiffuse);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
+	for (int i = 1, size = constraints.size(); i < size; ++i) {
+		::Render(constraints[i]);
+	}
+
+	// Static meshes are ground too
+	glColor3f(groundDiffuse[0], groundDiffuse[1], groundDiffuse[2]);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, groundAmbient);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, groundDiffuse);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
+	for (int i = 0, size = meshColliders.size(); i < size; ++i) {
+		if (meshColliders[i].model != 0) {
+			::Render(*meshColliders[i].model);
+		}
+	}
+	if (DebugRender) {
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+		GLboolean status;
+		glGetBooleanv(GL_LIGHTING, &status);
+
+		glDisable(GL_LIGHTING);
+		for (int i = 0; i < results.size(); ++i) {
+			::Render(results[i]);
+		}
+		if (status) {
+			glEnable(GL_LIGHTING);
+		}
+	}
+
+	// Render springs
+	GLboolean status;
+	glGetBooleanv(GL_LIGHTING, &status);
+	for (int i = 0, size = springs.size(); i < size; ++i) {
+		for (int i = 0, size = springs.size(); i < size; ++i) {
+			if (springs[i].GetP1() == 0 || springs[i].GetP2() == 0) {
+				continue;
+			}
+
+			Line l(springs[i].GetP1()->GetPosition(), springs[i].GetP2()->GetPosition());
+			::Render(l);
+		}
+	}
+	if (status) {
+		glEnable(GL_LIGHTING);
+	}
+
+	// Render all cloths
+	for (int i = 0, size = cloths.size(); i < size; ++i) {
+		cloths[i]->Render(DebugRender);
+	}
+}
+
+void RigidbodyVolume::Render() {
+	SynchCollisionVolumes();
+
+	if (type == RIGIDBODY_TYPE_SPHERE) {
+		::Render(sphere);
+	}
+	else if (type == RIGIDBODY_TYPE_BOX) {
+		::Render(box);
+	}
+	else if (type == RIGIDBODY_TYPE_CAPSULE) {
+		::Render(capsule);
+	}
+	else if (type == RIGIDBODY_TYPE_HULL && hullMesh != 0) {
+		glBegin(GL_TRIANGLES);
+		for (int i = 0, size = hullMesh->indices.size(); i < size; i += 3) {
+			Point v[3];
+			for (int j = 0; j < 3; ++j) {
+				v[j] = hull.position + MultiplyVector(hullMesh->vertices[hullMesh->indices[i + j]], hull.orientation);
+			}
+			vec3 normal = Normalized(Cross(v[1] - v[0], v[2] - v[0]));
+			glNormal3fv(normal.asArray);
+			glVertex3fv(v[0].asArray);
+			glVertex3fv(v[1].asArray);
+			glVertex3fv(v[2].asArray);
+		}
+		glEnd();
+	}
+}
+
+void Particle::Render() {
+	Sphere visual(position, 0.1f);
+	::Render(visual);
+}
+
+void Cloth::Render(bool debug) {
+	static const float redDiffuse[]{ 200.0f / 255.0f, 0.0f, 0.0f, 0.0f };
+	static const float redAmbient[]{ 200.0f / 255.0f, 50.0f / 255.0f, 50.0f / 255.0f, 0.0f };
+	static const float zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	glColor3f(redDiffuse[0], redDiffuse[1], redDiffuse[2]);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, redAmbient);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, redDiffuse);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
+
+	if (debug) {
+		for (int i = 0, size = verts.size(); i < size; ++i) {
+			verts[i].Render();
+		}
+
+		GLboolean status;
+		glGetBooleanv(GL_LIGHTING, &status);
+		glDisable(GL_LIGHTING);
+		
+		glColor3f(1.0f, 0.0f, 1.0f);
+		for (int i = 0, size = structural.size(); i < size; ++i) {
+			if (structural[i].GetP1() == 0 || structural[i].GetP2() == 0) {
+				continue;
+			}
+
+			Line l(structural[i].GetP1()->GetPosition(), structural[i].GetP2()->GetPosition());
+			::Render(l);
+		}
+
+		glColor3f(1.0f, 1.0f, 0.0f);
+		for (int i = 0, size = shear.size(); i < size; ++i) {
+			if (shear[i].GetP1() == 0 || shear[i].GetP2() == 0) {
+				continue;
+			}
+
+			Line l(shear[i].GetP1()->GetPosition(), shear[i].GetP2()->GetPosition());
+			::Render(l);
+		}
+
+		glColor3f(0.0f, 1.0f, 1.0f);
+		for (int i = 0, size = bend.size(); i < size; ++i) {
+			if (bend[i].GetP1() == 0 || bend[i].GetP2() == 0) {
+				continue;
+			}
+
+			vec3 p1 = bend[i].GetP1()->GetPosition();
+			vec3 p2 = bend[i].GetP2()->GetPosition();
+
+			// Visualization
+			/*p1.y += 0.1f;
+			p2.y += 0.1f;
+			for (int j = i; j >= 0; --j) {
+				p1.y += 0.1f;
+				p2.y += 0.1f;
+			}*/
+
+			Line l(p1, p2);
+			::Render(l);
+		}
+
+		if (status) {
+			glEnable(GL_LIGHTING);
+		}
+	}
+	else {
+		for (int x = 0; x < clothSize - 1; ++x) {
+			for (int z = 0; z < clothSize - 1; ++z) {
+				int tl = z * clothSize + x;
+				int bl = (z + 1) * clothSize + x;
+				int tr = z * clothSize + (x + 1);
+				int br = (z + 1) * clothSize + (x + 1);
+
+				Triangle t1(verts[tl].GetPosition(), verts[br].GetPosition(), verts[bl].GetPosition());
+				Triangle t2(verts[tl].GetPosition(), verts[tr].GetPosition(), verts[br].GetPosition());
+
+				::Render(t1, true);
+				::Render(t2, true);
+			}
+		}
+	}
+}
+
+void DistanceJoint::Render() {
+	vec3 pos1 = p1->GetPosition();
+	vec3 pos2 = p2->GetPosition();
+	Line l(pos1, pos2);
+	::Render(l);
+}
\ No newline at end of file
@@ -1,13 +1,81 @@
 #include "PhysicsSystem.h"
 #include "RigidbodyVolume.h"
-#include "FixedFunctionPrimitives.h"
-#include "glad/glad.h"
+#include "JobSystem.h"
+#include "Tracer.h"
 #include <iostream>
+#include <cmath>
+
+#ifdef PHYSICS_STATS
+#include <chrono>
+
+typedef std::chrono::high_resolution_clock StatsClock;
+
+// Milliseconds since timer, restarts the timer
+static float StatsLap(StatsClock::time_point& timer) {
+	StatsClock::time_point now = StatsClock::now();
+	float ms = std::chrono::duration<float, std::milli>(now - timer).count();
+	timer = now;
+	return ms;
+}
+
+#define STATS_BEGIN() \
+	ResetPhysicsStats(&stats); \
+	StatsClock::time_point statsStart = StatsClock::now(); \
+	StatsClock::time_point statsTimer = statsStart
+#define STATS_END() stats.total = StatsLap(statsStart)
+#define STATS_PHASE(phase) stats.phase += StatsLap(statsTimer)
+#define STATS_COUNT(counter, n) stats.counter += (int)(n)
+#else
+#define STATS_BEGIN()
+#define STATS_END()
+#define STATS_PHASE(phase)
+#define STATS_COUNT(counter, n)
+#endif
+
+#ifdef PHYSICS_STATS
+void ResetPhysicsStats(PhysicsStats* stats) {
+	if (stats != 0) {
+		stats->findPairs = 0.0f;
+		stats->applyForces = 0.0f;
+		stats->impulses = 0.0f;
+		stats->integration = 0.0f;
+		stats->linearProjection = 0.0f;
+		stats->springs = 0.0f;
+		stats->cloths = 0.0f;
+		stats->constraints = 0.0f;
+		stats->sweeps = 0.0f;
+		stats->total = 0.0f;
+
+		stats->pairsTested = 0;
+		stats->pairsColliding = 0;
+		stats->contacts = 0;
+		stats->impulseApplications = 0;
+		stats->bodiesAwake = 0;
+		stats->impacts = 0;
+		stats->speculativePairs = 0;
+	}
+}
+#endif
 
 PhysicsSystem::PhysicsSystem() {
 	LinearProjectionPercent = 0.45f;
 	PenetrationSlack = 0.01f;
 	ImpulseIteration = 5;
+	UseConstraintWorld = true;
+	UseSpeculativeContacts = false;
+	constraintWorldDirty = false;
+	FixedTimeStep = 0.0f;
+	MaxSubSteps = 4;
+	MaxSweepSubSteps = 4;
+	accumulator = 0.0f;
+
+	threadRunning.store(false);
+	threadTimeStep = 0.0f;
+	threadMaxSubSteps = 0;
+	writeSnapshot = 0;
+	sharedSnapshot.store(1);
+	readSnapshot = 2;
+	bodiesVersion = 0;
 
 	DebugRender = false;
 	DoLinearProjection = true;
@@ -16,96 +84,484 @@ PhysicsSystem::PhysicsSystem() {
 	colliders1.reserve(100);
 	colliders2.reserve(100);
 	results.reserve(100);
+	contacts.reserve(400);
+
+	staticBody.type = RIGIDBODY_TYPE_BOX;
+	staticBody.mass = 0.0f;
+#ifndef LINEAR_ONLY
+	staticBody.invTensorWorld = staticBody.InvTensorWorld();
+#endif
+
+#ifdef PHYSICS_STATS
+	ResetPhysicsStats(&stats);
+#endif
+}
+
+PhysicsSystem::~PhysicsSystem() {
+	StopThread();
 }
 
 void PhysicsSystem::Update(float deltaTime) {
+	TRACE_SCOPE("PhysicsSystem::Update");
+	if (threadRunning.load()) {
+		return;
+	}
+	if (FixedTimeStep <= 0.0f) {
+		Step(deltaTime);
+		return;
+	}
+
+	accumulator += deltaTime;
+	int steps = 0;
+	while (accumulator >= FixedTimeStep && steps < MaxSubSteps) {
+		SavePreviousTransforms();
+		Step(FixedTimeStep);
+		accumulator -= FixedTimeStep;
+		steps += 1;
+	}
+
+	// Fell too far behind, drop the time that could not be simulated
+	if (accumulator >= FixedTimeStep) {
+		accumulator = 0.0f;
+	}
+}
+
+void PhysicsSystem::SavePreviousTransforms() {
+	for (int i = 0, size = storageBodies.size(); i < size; ++i) {
+		prevPositions[i] = storageBodies[i]->position;
+#ifndef LINEAR_ONLY
+		prevOrientations[i] = storageBodies[i]->orientation;
+#endif
+	}
+}
+
+float PhysicsSystem::InterpolationAlpha() {
+	if (threadRunning.load()) {
+		// The next snapshot is due one step after the latest one
+		std::chrono::duration<float> since = std::chrono::steady_clock::now() - GetSnapshot().time;
+		return fminf(since.count() / threadTimeStep, 1.0f);
+	}
+	if (FixedTimeStep <= 0.0f) {
+		return 1.0f;
+	}
+	return accumulator / FixedTimeStep;
+}
+
+#ifdef PHYSICS_STATS
+const PhysicsStats& PhysicsSystem::GetStats() {
+	if (threadRunning.load()) {
+		return GetSnapshot().stats;
+	}
+	return stats;
+}
+#endif
+
+// Set in sharedSnapshot while the reader hasn't taken it yet
+#define SNAPSHOT_NEW 4
+
+void PhysicsSystem::PublishSnapshot() {
+	PhysicsSnapshot& snapshot = snapshots[writeSnapshot];
+	int size = storageBodies.size();
+	snapshot.prevPositions.assign(prevPositions.begin(), prevPositions.end());
+	snapshot.positions.resize(size);
+#ifndef LINEAR_ONLY
+	snapshot.prevOrientations.assign(prevOrientations.begin(), prevOrientations.end());
+	snapshot.orientations.resize(size);
+#endif
+	for (int i = 0; i < size; ++i) {
+		snapshot.positions[i] = storageBodies[i]->position;
+#ifndef LINEAR_ONLY
+		snapshot.orientations[i] = storageBodies[i]->orientation;
+#endif
+	}
+	snapshot.time = std::chrono::steady_clock::now();
+	snapshot.bodiesVersion = bodiesVersion;
+#ifdef PHYSICS_STATS
+	snapshot.stats = stats;
+#endif
+
+	writeSnapshot = sharedSnapshot.exchange(writeSnapshot | SNAPSHOT_NEW) & ~SNAPSHOT_NEW;
+}
+
+const PhysicsSnapshot& PhysicsSystem::GetSnapshot() {
+	if ((sharedSnapshot.load() & SNAPSHOT_NEW) != 0) {
+		readSnapshot = sharedSnapshot.exchange(readSnapshot) & ~SNAPSHOT_NEW;
+	}
+	return snapshots[readSnapshot];
+}
+
+void PhysicsSystem::ThreadLoop(PhysicsSystem* system) {
+	TraceThreadName("Physics");
+	typedef std::chrono::steady_clock Clock;
+	float deltaTime = system->threadTimeStep;
+	Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(deltaTime));
+	Clock::time_point next = Clock::now();
+	while (system->threadRunning.load()) {
+		{
+			std::lock_guard<std::mutex> lock(system->stepMutex);
+			system->SavePreviousTransforms();
+			system->Step(deltaTime);
+			system->PublishSnapshot();
+		}
+
+		// Behind by more than MaxSubSteps, drop the time that could
+		// not be simulated. Otherwise the next steps run right away
+		next += step;
+		Clock::time_point now = Clock::now();
+		if (now - next > step * system->threadMaxSubSteps) {
+			next = now;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
+
+void PhysicsSystem::StartThread() {
+	if (threadRunning.load()) {
+		return;
+	}
+	threadTimeStep = (FixedTimeStep > 0.0f) ? FixedTimeStep : 1.0f / 60.0f;
+	threadMaxSubSteps = (MaxSubSteps > 1) ? MaxSubSteps : 1;
+
+	// Something to read before the first step is done
+	SavePreviousTransforms();
+	PublishSnapshot();
+
+	threadRunning.store(true);
+	thread = std::thread(ThreadLoop, this);
+}
+
+void PhysicsSystem::StopThread() {
+	if (!threadRunning.load()) {
+		return;
+	}
+	threadRunning.store(false);
+	thread.join();
+	accumulator = 0.0f;
+}
+
+bool PhysicsSystem::IsThreaded() {
+	return threadRunning.load();
+}
+
+void PhysicsSystem::LockThread() {
+	stepMutex.lock();
+}
+
+void PhysicsSystem::UnlockThread() {
+	stepMutex.unlock();
+}
+
+// Bodies per job for the per body phases, see RunBodyJobs. A multiple
+// of 4, so IntegrateJob only leaves bodies to the scalar loop at the end
+#define BODY_JOB_GRAIN 64
+
+typedef struct BodyJobData {
+	Rigidbody** bodies;
+	float deltaTime;
+	const std::vector<OBB>* constraints;
+	const ConstraintWorld* world; // Used instead of constraints if set
+	bool skipVolumes; // Volumes in RigidbodyStorage
+	bool baseBodies; // Only bodies of the base type, or only the others
+} BodyJobData;
+
+static bool SkipBody(const BodyJobData& job, Rigidbody* body) {
+	if (job.skipVolumes && body->HasVolume()) {
+		return true;
+	}
+	return (body->type == RIGIDBODY_TYPE_BASE) != job.baseBodies;
+}
+
+static void ApplyForcesJob(void* data, int begin, int end) {
+	BodyJobData& job = *(BodyJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		if (!SkipBody(job, job.bodies[i])) {
+			job.bodies[i]->ApplyForces();
+		}
+	}
+}
+
+static void UpdateJob(void* data, int begin, int end) {
+	BodyJobData& job = *(BodyJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		if (!SkipBody(job, job.bodies[i])) {
+			job.bodies[i]->Update(job.deltaTime);
+		}
+	}
+}
+
+static void SolveConstraintsJob(void* data, int begin, int end) {
+	BodyJobData& job = *(BodyJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		if (SkipBody(job, job.bodies[i])) {
+			continue;
+		}
+		if (job.world != 0) {
+			job.bodies[i]->SolveConstraints(*job.world);
+		}
+		else {
+			job.bodies[i]->SolveConstraints(*job.constraints);
+		}
+	}
+}
+
+// Particles and volumes only change themselves, they run on the job
+// system. Bodies of the base type can change others (a joint moves
+// it's particles), they run on this thread once the jobs are done
+static void RunBodyJobs(BodyJobData* job, int numBodies, JobFunction function) {
+	job->baseBodies = false;
+	ParallelFor(numBodies, BODY_JOB_GRAIN, function, job);
+	job->baseBodies = true;
+	function(job, 0, numBodies);
+}
+
+// Rows of body pairs in one narrowphase job. The first rows have the
+// most pairs, there are enough jobs left for the other threads
+#define NARROWPHASE_JOB_ROWS 8
+// Bodies tested against the meshes in one job
+#define NARROWPHASE_JOB_BODIES 16
+
+typedef struct NarrowphaseJobData {
+	PhysicsSystem* system;
+	float deltaTime;
+	int firstBuffer; // Of the job that starts at item 0
+} NarrowphaseJobData;
+
+static void ClearNarrowphaseBuffer(NarrowphaseBuffer* buffer) {
+	buffer->colliders1.clear();
+	buffer->colliders2.clear();
+	buffer->results.clear();
+	buffer->pairsTested = 0;
+	buffer->speculativePairs = 0;
+}
+
+void PhysicsSystem::FindPairsJob(void* data, int begin, int end) {
+	NarrowphaseJobData& job = *(NarrowphaseJobData*)data;
+	PhysicsSystem& system = *job.system;
+	NarrowphaseBuffer& buffer = system.narrowphaseBuffers[job.firstBuffer + begin / NARROWPHASE_JOB_ROWS];
+	ClearNarrowphaseBuffer(&buffer);
+
+	CollisionManifold result;
+	for (int i = begin, size = system.storageBodies.size(); i < end; ++i) {
+		for (int j = i + 1; j < size; ++j) {
+			RigidbodyVolume* m1 = system.storageBodies[i];
+			RigidbodyVolume* m2 = system.storageBodies[j];
+			FindCollisionFeatures(*m1, *m2, &result);
+			buffer.pairsTested += 1;
+			if (!result.colliding && system.UseSpeculativeContacts) {
+				FindSpeculativeFeatures(*m1, *m2, job.deltaTime, &result);
+				buffer.speculativePairs += result.colliding ? 1 : 0;
+			}
+			if (result.colliding) {
+				buffer.colliders1.push_back(m1);
+				buffer.colliders2.push_back(m2);
+				buffer.results.push_back(result);
+			}
+		}
+	}
+}
+
+void PhysicsSystem::FindMeshPairsJob(void* data, int begin, int end) {
+	NarrowphaseJobData& job = *(NarrowphaseJobData*)data;
+	PhysicsSystem& system = *job.system;
+	NarrowphaseBuffer& buffer = system.narrowphaseBuffers[job.firstBuffer + begin / NARROWPHASE_JOB_BODIES];
+	ClearNarrowphaseBuffer(&buffer);
+
+	CollisionManifold meshResults[MESH_MAX_MANIFOLDS];
+	ConvexShape shape;
+	for (int i = begin; i < end; ++i) {
+		RigidbodyVolume* m1 = system.storageBodies[i];
+		if (m1->InvMass() == 0.0f || !GetConvexShape(*m1, &shape)) {
+			continue;
+		}
+		for (int j = 0, jSize = system.meshColliders.size(); j < jSize; ++j) {
+			int numResults = FindCollisionFeatures(shape, system.meshColliders[j], meshResults, MESH_MAX_MANIFOLDS);
+			buffer.pairsTested += 1;
+			if (numResults == 0 && system.UseSpeculativeContacts) {
+				FindSpeculativeFeatures(shape, m1->velocity * job.deltaTime, system.meshColliders[j], &meshResults[0]);
+				numResults = meshResults[0].colliding ? 1 : 0;
+				buffer.speculativePairs += numResults;
+			}
+			for (int k = 0; k < numResults; ++k) {
+				buffer.colliders1.push_back(m1);
+				buffer.colliders2.push_back(&system.staticBody);
+				buffer.results.push_back(meshResults[k]);
+			}
+		}
+	}
+}
+
+typedef struct IntegrateJobData {
+	PhysicsSystem* system;
+	float deltaTime;
+} IntegrateJobData;
+
+void PhysicsSystem::IntegrateJob(void* data, int begin, int end) {
+	IntegrateJobData& job = *(IntegrateJobData*)data;
+	PhysicsSystem& system = *job.system;
+	system.storage.ApplyForces(begin, end);
+	system.storage.Integrate(job.deltaTime, begin, end);
+	for (int i = begin; i < end; ++i) {
+		system.storage.Store(i, *system.storageBodies[i]);
+	}
+}
+
+void PhysicsSystem::Step(float deltaTime) {
+	TRACE_SCOPE("PhysicsSystem::Step");
+	STATS_BEGIN();
+
 	colliders1.clear();
 	colliders2.clear();
 	results.clear();
+	contacts.clear();
 
+	TRACE_BEGIN("FindPairs");
 	{ // Find objects whom are colliding
-	  // First, build a list of colliding objects
-		CollisionManifold result;
-		for (int i = 0, size = bodies.size(); i < size; ++i) {
-			for (int j = i; j < size; ++j) {
-				if (i == j) {
-					continue;
-				}
-				ResetCollisionManifold(&result);
-				if (bodies[i]->HasVolume() && bodies[j]->HasVolume()) {
-					RigidbodyVolume* m1 = (RigidbodyVolume*)bodies[i];
-					RigidbodyVolume* m2 = (RigidbodyVolume*)bodies[j];
-					result = FindCollisionFeatures(*m1, *m2);
-				}
-				if (result.colliding) {
-#if 0 
-					bool isDuplicate = false;
-					for (int k = 0, kSize = colliders1.size(); k < kSize; ++k) {
-						if (colliders1[k] == bodies[i] || colliders1[k] == bodies[j]) {
-							if (colliders2[k] == bodies[i] || colliders2[k] == bodies[j]) {
-								isDuplicate = true;
-								break;
-							}
-						}
-					}
-
-					if (!isDuplicate) {
-						for (int k = 0, kSize = colliders2.size(); k < kSize; ++k) {
-							if (colliders2[k] == bodies[i] || colliders2[k] == bodies[j]) {
-								if (colliders1[k] == bodies[i] || colliders1[k] == bodies[j]) {
-									isDuplicate = true;
-									break;
-								}
-							}
-						}
-					}
-					if (!isDuplicate)
-#endif
+	  // First, build a list of colliding objects.
+	  // Only volumes can collide, so only pairs of them are tested.
+	  // storageBodies holds them in the same order as bodies.
+	  // Rows of pairs run as jobs, then every moving body against the
+	  // static meshes
+		int numBodies = (int)storageBodies.size();
+		int pairJobs = (numBodies + NARROWPHASE_JOB_ROWS - 1) / NARROWPHASE_JOB_ROWS;
+		int meshJobs = meshColliders.empty() ? 0 : (numBodies + NARROWPHASE_JOB_BODIES - 1) / NARROWPHASE_JOB_BODIES;
+		if ((int)narrowphaseBuffers.size() < pairJobs + meshJobs) {
+			narrowphaseBuffers.resize(pairJobs + meshJobs);
+		}
 
-					{
-						colliders1.push_back(bodies[i]);
-						colliders2.push_back(bodies[j]);
-						results.push_back(result);
-					}
-				}
-			}
+		NarrowphaseJobData job;
+		job.system = this;
+		job.deltaTime = deltaTime;
+		job.firstBuffer = 0;
+		ParallelFor(numBodies, NARROWPHASE_JOB_ROWS, FindPairsJob, &job);
+		if (meshJobs > 0) {
+			job.firstBuffer = pairJobs;
+			ParallelFor(numBodies, NARROWPHASE_JOB_BODIES, FindMeshPairsJob, &job);
 		}
-	}
 
-	// Calculate foces acting on the object
-	for (int i = 0, size = bodies.size(); i < size; ++i) {
-		bodies[i]->ApplyForces();
+		for (int i = 0; i < pairJobs + meshJobs; ++i) {
+			NarrowphaseBuffer& buffer = narrowphaseBuffers[i];
+			colliders1.insert(colliders1.end(), buffer.colliders1.begin(), buffer.colliders1.end());
+			colliders2.insert(colliders2.end(), buffer.colliders2.begin(), buffer.colliders2.end());
+			results.insert(results.end(), buffer.results.begin(), buffer.results.end());
+			STATS_COUNT(pairsTested, buffer.pairsTested);
+			STATS_COUNT(speculativePairs, buffer.speculativePairs);
+		}
 	}
+	STATS_COUNT(pairsColliding, results.size());
+	STATS_PHASE(findPairs);
+	TRACE_END();
+
+	// Calculate foces acting on the object. Volumes are handled by
+	// the storage, before integration
+	TRACE_BEGIN("ApplyForces");
+	BodyJobData bodyJob;
+	bodyJob.bodies = bodies.empty() ? 0 : &bodies[0];
+	bodyJob.deltaTime = deltaTime;
+	bodyJob.constraints = &constraints;
+	bodyJob.world = UseConstraintWorld ? &constraintWorld : 0;
+	bodyJob.skipVolumes = true;
+	RunBodyJobs(&bodyJob, (int)bodies.size(), ApplyForcesJob);
+	STATS_PHASE(applyForces);
+	TRACE_END();
 
 	// Same as above, calculate forces acting on cloths
 	for (int i = 0, size = cloths.size(); i < size; ++i) {
 		cloths[i]->ApplyForces();
 	}
+	STATS_PHASE(cloths);
+
+	TRACE_BEGIN("Impulses");
+#ifndef LINEAR_ONLY
+	// Cache world space inverse inertia, once per body
+	for (int i = 0, size = bodies.size(); i < size; ++i) {
+		if (bodies[i]->HasVolume()) {
+			RigidbodyVolume* m = (RigidbodyVolume*)bodies[i];
+			m->invTensorWorld = m->InvTensorWorld();
+		}
+	}
+#endif
+
+	// Pre-step, everything that stays constant between iterations
+	for (int i = 0, size = results.size(); i < size; ++i) {
+		if (!colliders1[i]->HasVolume() || !colliders2[i]->HasVolume()) {
+			continue;
+		}
+		RigidbodyVolume* m1 = (RigidbodyVolume*)colliders1[i];
+		RigidbodyVolume* m2 = (RigidbodyVolume*)colliders2[i];
+		for (int j = 0, jSize = results[i].numContacts; j < jSize; ++j) {
+			contacts.push_back(ContactConstraint());
+			PrepareContact(&contacts.back(), *m1, *m2, results[i], j);
+			if (results[i].depths[j] < 0.0f) {
+				// Speculative, no bounce or friction until they touch.
+				// They may close the gap in this step but no more
+				ContactConstraint& C = contacts.back();
+				C.bias = results[i].depths[j] / deltaTime;
+#ifdef DYNAMIC_FRICTION
+				C.staticFriction = 0.0f;
+				C.dynamicFriction = 0.0f;
+#else
+				C.friction = 0.0f;
+#endif
+			}
+		}
+	}
 
 	// Apply impulses to resolve collisions
 	for (int k = 0; k < ImpulseIteration; ++k) { // Apply impulses
-		for (int i = 0, size = results.size(); i < size; ++i) {
-			for (int j = 0, jSize = results[i].contacts.size(); j < jSize; ++j) {
-				if (colliders1[i]->HasVolume() && colliders2[i]->HasVolume()) {
-					RigidbodyVolume* m1 = (RigidbodyVolume*)colliders1[i];
-					RigidbodyVolume* m2 = (RigidbodyVolume*)colliders2[i];
-					ApplyImpulse(*m1, *m2, results[i], j);
-				}
-			}
+		for (int i = 0, size = contacts.size(); i < size; ++i) {
+			ApplyImpulse(contacts[i]);
 		}
+		STATS_COUNT(impulseApplications, contacts.size());
+	}
+	for (int i = 0, size = results.size(); i < size; ++i) {
+		SetStorageState((RigidbodyVolume*)colliders1[i]);
+		SetStorageState((RigidbodyVolume*)colliders2[i]);
 	}
+	STATS_COUNT(contacts, contacts.size());
+	STATS_PHASE(impulses);
+	TRACE_END();
 
 	// Integrate velocity and impulse of objects
-	for (int i = 0, size = bodies.size(); i < size; ++i) {
-		bodies[i]->Update(deltaTime);
+	TRACE_BEGIN("Integrate");
+	bool anyContinuous = false;
+	for (int i = 0, size = storageBodies.size(); i < size; ++i) {
+		if (storageBodies[i]->continuous) {
+			sweepStarts[i] = storageBodies[i]->position;
+			anyContinuous = true;
+		}
+	}
+	RunBodyJobs(&bodyJob, (int)bodies.size(), UpdateJob);
+
+	// Same as above, for the volumes. Every box, sphere, capsule and
+	// hull goes through the SIMD integrator, then gets the new state
+	IntegrateJobData integrateJob;
+	integrateJob.system = this;
+	integrateJob.deltaTime = deltaTime;
+	ParallelFor((int)storageBodies.size(), BODY_JOB_GRAIN, IntegrateJob, &integrateJob);
+	STATS_PHASE(integration);
+	TRACE_END();
+
+	// Catch continuous bodies that went through something
+	if (anyContinuous) {
+		TRACE_BEGIN("Sweeps");
+		for (int i = 0, size = storageBodies.size(); i < size; ++i) {
+			if (storageBodies[i]->continuous && storageBodies[i]->InvMass() != 0.0f) {
+				SweepBody(i, deltaTime);
+				SetStorageState(storageBodies[i]);
+			}
+		}
+		STATS_PHASE(sweeps);
+		TRACE_END();
 	}
 
 	// Same as above, integrate velocity and impulse of cloths
 	for (int i = 0, size = cloths.size(); i < size; ++i) {
 		cloths[i]->Update(deltaTime);
 	}
+	STATS_PHASE(cloths);
 
 	// Correct position to avoid sinking!
+	TRACE_BEGIN("LinearProjection");
 	if (DoLinearProjection) {
 		for (int i = 0, size = results.size(); i < size; ++i) {
 			if (!colliders1[i]->HasVolume() && !colliders2[i]->HasVolume()) {
@@ -127,151 +583,215 @@ void PhysicsSystem::Update(float deltaTime) {
 			m1->position = m1->position - correction * m1->InvMass();
 			m2->position = m2->position + correction * m2->InvMass();
 
-			m1->SynchCollisionVolumes();
-			m2->SynchCollisionVolumes();
+			m1->SynchCollisionPositions();
+			m2->SynchCollisionPositions();
+			SetStorageState(m1);
+			SetStorageState(m2);
 		}
 	}
+	STATS_PHASE(linearProjection);
+	TRACE_END();
 
 	// Apply spring forces
+	TRACE_BEGIN("Springs");
 	for (int i = 0, size = springs.size(); i < size; ++i) {
 		springs[i].ApplyForce(deltaTime);
 	}
+	STATS_PHASE(springs);
+	TRACE_END();
 
 	// Same as above, apply spring forces for cloths
 	for (int i = 0, size = cloths.size(); i < size; ++i) {
 		cloths[i]->ApplySpringForces(deltaTime);
 	}
+	STATS_PHASE(cloths);
 
 	// Solve constraints
-	for (int i = 0, size = bodies.size(); i < size; ++i) {
-		bodies[i]->SolveConstraints(constraints);
+	TRACE_BEGIN("SolveConstraints");
+	if (UseConstraintWorld && constraintWorldDirty) {
+		BuildConstraintWorld(constraints, &constraintWorld);
+		constraintWorldDirty = false;
 	}
+	bodyJob.skipVolumes = false;
+	RunBodyJobs(&bodyJob, (int)bodies.size(), SolveConstraintsJob);
+
+	STATS_PHASE(constraints);
+	TRACE_END();
 
 	// Same as above, solve cloth constraints
 	for (int i = 0, size = cloths.size(); i < size; ++i) {
-		cloths[i]->SolveConstraints(constraints);
+		if (UseConstraintWorld) {
+			cloths[i]->SolveConstraints(constraintWorld);
+		}
+		else {
+			cloths[i]->SolveConstraints(constraints);
+		}
+	}
+	STATS_PHASE(cloths);
+
+#ifdef PHYSICS_STATS
+	// Integration snaps small velocities to 0, anything else is moving
+	for (int i = 0, size = storageBodies.size(); i < size; ++i) {
+		RigidbodyVolume* body = storageBodies[i];
+		bool moving = MagnitudeSq(body->velocity) > 0.0f;
+#ifndef LINEAR_ONLY
+		moving = moving || MagnitudeSq(body->angVel) > 0.0f;
+#endif
+		STATS_COUNT(bodiesAwake, moving ? 1 : 0);
 	}
+#endif
+	STATS_END();
 }
 
-void PhysicsSystem::Render() {
-	if (DebugRender) {
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+// Only spheres much smaller than the body are swept. Bodies resting on
+// or sliding over something never touch it with the sphere, and once
+// the sphere hits the body is deep enough for FindCollisionFeatures
+#define SWEEP_RADIUS_SCALE 0.5f
+#define SWEEP_TOLERANCE 0.001f
+
+void PhysicsSystem::SetStorageState(RigidbodyVolume* body) {
+	// The static body of the meshes is not in the storage
+	if (body->handle >= 0) {
+		storage.SetState(body->handle, *body);
 	}
-	static const float rigidbodyDiffuse[]{ 200.0f / 255.0f, 0.0f, 0.0f, 0.0f };
-	static const float rigidbodyAmbient[]{ 200.0f / 255.0f, 50.0f / 255.0f, 50.0f / 255.0f, 0.0f };
+}
 
-	static const float groundDiffuse[]{ 0.0f, 0.0f, 200.0f / 255.0f, 0.0f };
-	static const float groundAmbient[]{ 50.0f / 255.0f, 50.0f / 255.0f, 200.0f / 255.0f, 0.0f };
+void PhysicsSystem::SweepBody(int index, float deltaTime) {
+	RigidbodyVolume* body = storageBodies[index];
+	float radius = InnerRadius(*body) * SWEEP_RADIUS_SCALE;
+	vec3 from = sweepStarts[index];
+	float remaining = deltaTime;
+	for (int step = 0; step < MaxSweepSubSteps && radius > 0.0f; ++step) {
+		// Slow enough that the sphere can't get through anything
+		vec3 motion = body->position - from;
+		float motionSq = MagnitudeSq(motion);
+		if (motionSq <= radius * radius) {
+			return;
+		}
 
-	static const float constraintDiffuse[]{ 0.0f, 200.0f / 255.0f, 0.0f, 0.0f };
-	static const float constraintAmbient[]{ 50.0f / 255.0f, 200.0f / 255.0f, 50.0f / 255.0f, 0.0f };
-	
-	static const float zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		Sphere core(from, radius);
+		ConvexShape sweep(core);
+		float first = 1.0f;
+		RigidbodyVolume* other = 0;
+		int mesh = -1;
+		for (int i = 0, size = storageBodies.size(); i < size; ++i) {
+			RigidbodyVolume* candidate = storageBodies[i];
+			ConvexShape shape;
+			if (i == index || !GetConvexShape(*candidate, &shape)) {
+				continue;
+			}
 
-	std::vector<const float*> ambient;
-	std::vector<const float*> diffuse;
-	if (RenderRandomColors) {
-		ambient.push_back(rigidbodyAmbient);
-		ambient.push_back(groundAmbient);
-		ambient.push_back(constraintAmbient);
-		diffuse.push_back(rigidbodyDiffuse);
-		diffuse.push_back(groundDiffuse);
-		diffuse.push_back(constraintDiffuse);
-	}
+			// Too far from the path to be hit
+			float along = fminf(fmaxf(Dot(candidate->position - from, motion) / motionSq, 0.0f), 1.0f);
+			float reach = BoundingRadius(*candidate) + radius;
+			if (MagnitudeSq(candidate->position - (from + motion * along)) > reach * reach) {
+				continue;
+			}
 
-	glColor3f(rigidbodyDiffuse[0], rigidbodyDiffuse[1], rigidbodyDiffuse[2]);
-	glLightfv(GL_LIGHT0, GL_AMBIENT, rigidbodyAmbient);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, rigidbodyDiffuse);
-	glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
-	for (int i = 0, size = bodies.size(); i < size; ++i) {
-		if (RenderRandomColors) {
-			int a_i = i % ambient.size();
-			int d_i = i % diffuse.size();
-			glColor3f(diffuse[d_i][0], diffuse[d_i][1], diffuse[d_i][2]);
-			glLightfv(GL_LIGHT0, GL_AMBIENT, ambient[a_i]);
-			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse[d_i]);
-			glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
+			float t = TimeOfImpact(sweep, motion, shape, SWEEP_TOLERANCE, 0, 0);
+			if (t < first) {
+				first = t;
+				other = candidate;
+			}
 		}
-		if (DebugRender && bodies[i]->type == RIGIDBODY_TYPE_BOX) {
-			RigidbodyVolume* mb = (RigidbodyVolume*)bodies[i];
-			mb->SynchCollisionVolumes();
-			::Render(GetEdges(mb->box));
+		for (int i = 0, size = meshColliders.size(); i < size; ++i) {
+			float t = TimeOfImpact(sweep, motion, meshColliders[i], SWEEP_TOLERANCE, 0, 0);
+			if (t < first) {
+				first = t;
+				other = &staticBody;
+				mesh = i;
+			}
 		}
-		else {
-			bodies[i]->Render();
+		if (other == 0) {
+			return;
 		}
-	}
+		STATS_COUNT(impacts, 1);
 
-	// First constraint is usually the ground
-	// Rendering it diferent color is just a hack to make visualization easyer
-	// Normally, you wouldn't even render physics geo!
-	if (constraints.size() > 0) {
-		glColor3f(groundDiffuse[0], groundDiffuse[1], groundDiffuse[2]);
-		glLightfv(GL_LIGHT0, GL_AMBIENT, groundAmbient);
-		glLightfv(GL_LIGHT0, GL_DIFFUSE, groundDiffuse);
-		glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
-		::Render(constraints[0]);
-	}
+		// Back to the impact, the body overlaps what it hit there
+		body->position = from + motion * first;
+		body->SynchCollisionPositions();
 
-	glColor3f(constraintDiffuse[0], constraintDiffuse[1], constraintDiffuse[2]);
-	glLightfv(GL_LIGHT0, GL_AMBIENT, constraintAmbient);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, constraintDiffuse);
-	glLightfv(GL_LIGHT0, GL_SPECULAR, zero);
-	for (int i = 1, size = constraints.size(); i < size; ++i) {
-		::Render(constraints[i]);
-	}
-	if (DebugRender) {
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-		GLboolean status;
-		glGetBooleanv(GL_LIGHTING, &status);
-
-		glDisable(GL_LIGHTING);
-		for (int i = 0; i < results.size(); ++i) {
-			::Render(results[i]);
+		CollisionManifold manifolds[MESH_MAX_MANIFOLDS];
+		int numManifolds = 0;
+		ConvexShape shape;
+		if (mesh >= 0 && GetConvexShape(*body, &shape)) {
+			numManifolds = FindCollisionFeatures(shape, meshColliders[mesh], manifolds, MESH_MAX_MANIFOLDS);
 		}
-		if (status) {
-			glEnable(GL_LIGHTING);
+		else if (mesh < 0) {
+			FindCollisionFeatures(*body, *other, &manifolds[0]);
+			numManifolds = manifolds[0].colliding ? 1 : 0;
 		}
-	}
 
-	// Render springs
-	GLboolean status;
-	glGetBooleanv(GL_LIGHTING, &status);
-	for (int i = 0, size = springs.size(); i < size; ++i) {
-		for (int i = 0, size = springs.size(); i < size; ++i) {
-			if (springs[i].GetP1() == 0 || springs[i].GetP2() == 0) {
-				continue;
+		// Solve it right away, only against what was hit
+		ContactConstraint impacts[MESH_MAX_MANIFOLDS * MAX_MANIFOLD_CONTACTS];
+		int numImpacts = 0;
+#ifndef LINEAR_ONLY
+		body->invTensorWorld = body->InvTensorWorld();
+#endif
+		for (int i = 0; i < numManifolds; ++i) {
+			for (int j = 0; j < manifolds[i].numContacts; ++j) {
+				PrepareContact(&impacts[numImpacts++], *body, *other, manifolds[i], j);
 			}
+		}
+		for (int k = 0; k < ImpulseIteration; ++k) {
+			for (int i = 0; i < numImpacts; ++i) {
+				ApplyImpulse(impacts[i]);
+			}
+		}
+		SetStorageState(other);
 
-			Line l(springs[i].GetP1()->GetPosition(), springs[i].GetP2()->GetPosition());
-			::Render(l);
+		// Out of sub steps, stay at the impact
+		remaining *= 1.0f - first;
+		if (step + 1 == MaxSweepSubSteps) {
+			return;
 		}
-	}
-	if (status) {
-		glEnable(GL_LIGHTING);
-	}
 
-	// Render all cloths
-	for (int i = 0, size = cloths.size(); i < size; ++i) {
-		cloths[i]->Render(DebugRender);
+		// The rest of the step with the new velocity
+		from = body->position;
+		body->position = from + body->velocity * remaining;
+		body->SynchCollisionPositions();
 	}
 }
 
 void PhysicsSystem::AddRigidbody(Rigidbody* body) {
 	bodies.push_back(body);
+	bodiesVersion += 1;
+
+	if (body->HasVolume()) {
+		RigidbodyVolume* volume = (RigidbodyVolume*)body;
+		volume->handle = storage.AddBody(*volume);
+		storageBodies.push_back(volume);
+		sweepStarts.push_back(volume->position);
+
+		prevPositions.push_back(volume->position);
+#ifndef LINEAR_ONLY
+		prevOrientations.push_back(volume->orientation);
+#endif
+	}
 }
 
 void PhysicsSystem::AddConstraint(const OBB& obb) {
 	constraints.push_back(obb);
+	constraintWorldDirty = true;
 }
 
 void PhysicsSystem::ClearRigidbodys() {
 	bodies.clear();
+	bodiesVersion += 1;
+	storage.Clear();
+	storageBodies.clear();
+	sweepStarts.clear();
+
+	prevPositions.clear();
+#ifndef LINEAR_ONLY
+	prevOrientations.clear();
+#endif
+	accumulator = 0.0f;
 }
 
 void PhysicsSystem::ClearConstraints() {
 	constraints.clear();
+	constraintWorldDirty = true;
 }
 
 void PhysicsSystem::AddSpring(const Spring& spring) {
@@ -288,4 +808,13 @@ void PhysicsSystem::AddCloth(Cloth* cloth) {
 
 void PhysicsSystem::ClearCloths() {
 	cloths.clear();
+}
+
+void PhysicsSystem::AddMeshCollider(Model* model) {
+	meshColliders.push_back(MeshCollider());
+	BuildMeshCollider(model, &meshColliders.back());
+}
+
+void PhysicsSystem::ClearMeshColliders() {
+	meshColliders.clear();
 }
\ No newline at end of file
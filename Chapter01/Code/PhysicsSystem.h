@@ -2,23 +2,195 @@
 #define _H_PHYSICS_SYSTEM_
 
 #include "Rigidbody.h"
+#include "RigidbodyVolume.h"
+#include "RigidbodyStorage.h"
+#include "MeshCollider.h"
 #include "Spring.h"
 #include "Cloth.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// If PHYSICS_STATS is defined, Step records how long each of it's
+// phases took along with a few counters. They can be read with
+// GetStats after every step. It's defined unless NO_PHYSICS_STATS
+// is, then none of this is compiled in.
+
+#ifndef NO_PHYSICS_STATS
+#define PHYSICS_STATS
+#endif
+
+#ifdef PHYSICS_STATS
+typedef struct PhysicsStats {
+	// Wall time of each phase in milliseconds. Cloths are timed
+	// on their own, they are not part of the other phases
+	float findPairs;
+	float applyForces;
+	float impulses;
+	float integration;
+	float linearProjection;
+	float springs;
+	float cloths;
+	float constraints;
+	float sweeps; // Continuous bodies, see SweepBody
+	float total;
+
+	int pairsTested; // Pairs of volume bodies that were tested
+	int pairsColliding;
+	int contacts;
+	int impulseApplications;
+	int bodiesAwake; // Volume bodies still moving after the step
+	int impacts; // Times a continuous body was stopped by a sweep
+	int speculativePairs; // Separated pairs that got a speculative contact
+} PhysicsStats;
+
+void ResetPhysicsStats(PhysicsStats* stats);
+#endif
+
+// What one job of the narrowphase found. The buffers of all jobs are
+// appended in job order, so the manifolds are the same no matter how
+// many threads ran them
+typedef struct NarrowphaseBuffer {
+	std::vector<Rigidbody*, TaggedAllocator<Rigidbody*, MEMORY_TAG_PHYSICS> > colliders1;
+	std::vector<Rigidbody*, TaggedAllocator<Rigidbody*, MEMORY_TAG_PHYSICS> > colliders2;
+	std::vector<CollisionManifold, TaggedAllocator<CollisionManifold, MEMORY_TAG_MANIFOLD> > results;
+
+	// Added to PhysicsStats when merged
+	int pairsTested;
+	int speculativePairs;
+} NarrowphaseBuffer;
+
+// Transforms of the volume bodies after one step of the physics thread,
+// see StartThread. Indexed in the order the volume bodies were added.
+// The transforms from before the step are kept too, so a reader can
+// interpolate between the two
+typedef struct PhysicsSnapshot {
+	std::vector<vec3> prevPositions;
+	std::vector<vec3> positions;
+#ifndef LINEAR_ONLY
+	std::vector<quat> prevOrientations;
+	std::vector<quat> orientations;
+#endif
+	std::chrono::steady_clock::time_point time; // When it was published
+	int bodiesVersion; // Doesn't match the system after bodies changed
+#ifdef PHYSICS_STATS
+	PhysicsStats stats; // Of the step
+#endif
+} PhysicsSnapshot;
 
 class PhysicsSystem {
 protected:
 	std::vector<Rigidbody*> bodies;
 	std::vector<Cloth*> cloths;
 	std::vector<OBB> constraints;
+	// BVH over the constraints, rebuilt on the next step after they change
+	ConstraintWorld constraintWorld;
+	bool constraintWorldDirty;
 	std::vector<Spring> springs;
 
-	std::vector<Rigidbody*> colliders1;
-	std::vector<Rigidbody*> colliders2;
-	std::vector<CollisionManifold> results;
+	// Static triangle meshes. A contact against one of them is solved
+	// as a contact with staticBody, which has no mass and never moves
+	std::vector<MeshCollider> meshColliders;
+	RigidbodyVolume staticBody;
+
+	// Rebuilt every step, tagged to see what the solver allocates
+	std::vector<Rigidbody*, TaggedAllocator<Rigidbody*, MEMORY_TAG_PHYSICS> > colliders1;
+	std::vector<Rigidbody*, TaggedAllocator<Rigidbody*, MEMORY_TAG_PHYSICS> > colliders2;
+	std::vector<CollisionManifold, TaggedAllocator<CollisionManifold, MEMORY_TAG_MANIFOLD> > results;
+	std::vector<ContactConstraint, TaggedAllocator<ContactConstraint, MEMORY_TAG_PHYSICS> > contacts;
+
+	// State of the volume bodies, storageBodies maps a handle back to
+	// the body. Forces and integration run over the arrays. Phases that
+	// work on single bodies (impulses, sweeps, projection) change the
+	// bodies, the ones they changed are copied back with SetState
+	RigidbodyStorage storage;
+	std::vector<RigidbodyVolume*> storageBodies;
+
+	// Where each of storageBodies was before it was integrated. Only
+	// kept for continuous bodies, the sweep starts there
+	std::vector<vec3, TaggedAllocator<vec3, MEMORY_TAG_PHYSICS> > sweepStarts;
+
+	// Fixed step mode state. Transforms are indexed the same as
+	// storageBodies and saved before every step, rendering blends
+	// them with the current ones
+	float accumulator;
+	std::vector<vec3> prevPositions;
+#ifndef LINEAR_ONLY
+	std::vector<quat> prevOrientations;
+#endif
+
+#ifdef PHYSICS_STATS
+	PhysicsStats stats; // Of the last call to Step
+#endif
+
+	// Copies the state of body back to storage after it was changed
+	// outside of integration. Does nothing for staticBody
+	void SetStorageState(RigidbodyVolume* body);
+
+	// Sweeps a sphere inside of the body from where it was before it
+	// was integrated to where it is now. At the first impact the body
+	// is moved back, the contact is solved, and the body moves on with
+	// what's left of the step. Up to MaxSweepSubSteps times
+	void SweepBody(int index, float deltaTime);
+
+	// Kept between steps so the narrowphase doesn't allocate. The pair
+	// jobs come first, then the mesh jobs
+	std::vector<NarrowphaseBuffer> narrowphaseBuffers;
+	// Narrowphase jobs, data is a NarrowphaseJobData. FindPairsJob
+	// tests pairs (i, j) of storageBodies for rows i in [begin, end),
+	// FindMeshPairsJob tests bodies [begin, end) against the meshes
+	static void FindPairsJob(void* data, int begin, int end);
+	static void FindMeshPairsJob(void* data, int begin, int end);
+	// Integrates storageBodies [begin, end) through the storage and
+	// stores them, data is an IntegrateJobData
+	static void IntegrateJob(void* data, int begin, int end);
+
+	// Physics thread state. stepMutex is held while the thread steps
+	std::thread thread;
+	std::atomic<bool> threadRunning;
+	std::mutex stepMutex;
+	// Set by StartThread, so changing the settings while it runs
+	// can't make the thread step without waiting
+	float threadTimeStep;
+	int threadMaxSubSteps;
+	// Triple buffer of snapshots. The thread fills the write one, then
+	// swaps it with the shared one. GetSnapshot swaps the shared one
+	// with the read one if it's newer. Neither side ever waits
+	PhysicsSnapshot snapshots[3];
+	std::atomic<int> sharedSnapshot; // Index, | SNAPSHOT_NEW until read
+	int writeSnapshot; // Only used by the physics thread
+	int readSnapshot; // Only used by GetSnapshot
+	int bodiesVersion; // Changed by AddRigidbody and ClearRigidbodys
+
+	// Saves the volume bodies into prevPositions and prevOrientations
+	void SavePreviousTransforms();
+	void PublishSnapshot();
+	static void ThreadLoop(PhysicsSystem* system);
 public:
 	float LinearProjectionPercent; // [0.2 to 0.8], Smaller = less jitter / more penetration
 	float PenetrationSlack; // [0.01 to 0.1],  Samller = more accurate
 	int ImpulseIteration;
+	// Particles and cloths only test the constraints near them, found
+	// through constraintWorld, instead of every constraint
+	bool UseConstraintWorld;
+	// Pairs that are apart, but close enough to touch within the step
+	// at their current velocities, get contacts with a negative depth.
+	// The solver only removes the velocity that would close the gap,
+	// so fast bodies don't tunnel without being swept. Against meshes
+	// only the linear velocity is used
+	bool UseSpeculativeContacts;
+	// If FixedTimeStep is > 0, Update adds it's delta time to an
+	// accumulator and runs Step with FixedTimeStep until less than
+	// one step is left. At most MaxSubSteps steps run per Update,
+	// time beyond that is dropped so a slow frame can't cause an
+	// even slower one. Render interpolates volume bodies between
+	// the last two steps.
+	float FixedTimeStep;
+	int MaxSubSteps;
+	// Impacts a continuous body can have in one step, after the last
+	// one it stays where it hit
+	int MaxSweepSubSteps;
 
 	// Not in book, just for debug purposes
 	bool DebugRender;
@@ -26,19 +198,59 @@ public:
 	bool RenderRandomColors;
 
 	PhysicsSystem();
+	~PhysicsSystem();
 
 	void Update(float deltaTime);
+	void Step(float deltaTime);
+#ifndef NO_RENDER
 	void Render();
+#endif
+
+	// [0 to 1], how far rendering is between the last two steps
+	float InterpolationAlpha();
+
+	// StartThread runs Step with FixedTimeStep (1/60 if it's not set)
+	// on a thread of it's own, at that rate in real time, until
+	// StopThread. Like Update it falls at most MaxSubSteps steps behind.
+	// Both are read once here, changes take effect on the next start.
+	// After every step the transforms of the volume bodies are published
+	// as a snapshot. Render and GetSnapshot read the latest complete one
+	// without waiting for the step in progress, so frame time and step
+	// time don't add up. Update does nothing while the thread runs.
+	// Anything else Render draws (particles, springs, cloths, contacts)
+	// is read live, after the step in progress.
+	// While it runs, bodies and settings must only be changed between
+	// LockThread and UnlockThread, which waits for the step in progress
+	void StartThread();
+	void StopThread();
+	bool IsThreaded();
+	void LockThread();
+	void UnlockThread();
+	// Latest snapshot of the physics thread. Only call it from one
+	// thread, the one that renders. Not updated without the thread
+	const PhysicsSnapshot& GetSnapshot();
+
+#ifdef PHYSICS_STATS
+	// Of the latest snapshot while the physics thread runs
+	const PhysicsStats& GetStats();
+#endif
 	
+	// The position, velocity, orientation, angular velocity, mass and
+	// shape of a volume body are read when it's added. After that the
+	// system writes them, clear and add the bodies again to change them
 	void AddRigidbody(Rigidbody* body);
 	void AddCloth(Cloth* cloth);
 	void AddSpring(const Spring& spring);
 	void AddConstraint(const OBB& constraint);
+	// The model is not owned, it must outlive the system. Moving it
+	// after it's added is fine, it's transform is read every step
+	void AddMeshCollider(Model* model);
 
 	void ClearRigidbodys();
 	void ClearConstraints();
 	void ClearSprings();
 	void ClearCloths();
+	void ClearMeshColliders();
 };
 
 #endif
\ No newline at end of file
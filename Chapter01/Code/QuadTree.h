@@ -3,6 +3,7 @@
 
 #include "Geometry2D.h"
 #include <vector>
+#include "MemoryTracker.h"
 
 using std::vector;
 
@@ -19,8 +20,8 @@ struct QuadTreeData {
 
 class QuadTreeNode {
 protected:
-	std::vector<QuadTreeNode> children;
-	vector<QuadTreeData*> contents;
+	std::vector<QuadTreeNode, TaggedAllocator<QuadTreeNode, MEMORY_TAG_QUADTREE> > children;
+	vector<QuadTreeData*, TaggedAllocator<QuadTreeData*, MEMORY_TAG_QUADTREE> > contents;
 	int currentDepth;
 	static int maxDepth;
 	static int maxObjectsPerNode;
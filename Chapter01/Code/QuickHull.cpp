@@ -0,0 +1,369 @@
+#include "QuickHull.h"
+#include <cmath>
+#include <cfloat>
+
+typedef struct HullFace {
+	int v[3]; // Index into the input points
+	vec3 normal;
+	float distance;
+	std::vector<int> outside; // Points in front of the face
+	int furthest; // The outside point furthest from the face, -1 if none
+	float furthestDistance;
+	bool removed;
+} HullFace;
+
+// Winds the face so its normal points away from inside
+static void InitFace(HullFace* face, const Point* points, int a, int b, int c, const Point& inside) {
+	vec3 n = Cross(points[b] - points[a], points[c] - points[a]);
+	if (Dot(n, inside - points[a]) > 0.0f) {
+		int t = b;
+		b = c;
+		c = t;
+		n = n * -1.0f;
+	}
+	float length = Magnitude(n);
+	if (length > 0.0f) {
+		n = n * (1.0f / length);
+	}
+
+	face->v[0] = a;
+	face->v[1] = b;
+	face->v[2] = c;
+	face->normal = n;
+	face->distance = Dot(n, points[a]);
+	face->outside.clear();
+	face->furthest = -1;
+	face->furthestDistance = 0.0f;
+	face->removed = false;
+}
+
+// Gives the point to the face (starting at first) it is furthest in
+// front of. Points that are behind every face are inside the hull
+static void AssignPoint(std::vector<HullFace>& faces, int first, int point, const Point* points, float epsilon) {
+	int best = -1;
+	float bestDistance = epsilon;
+	for (int i = first, size = (int)faces.size(); i < size; ++i) {
+		if (faces[i].removed) {
+			continue;
+		}
+		float distance = Dot(faces[i].normal, points[point]) - faces[i].distance;
+		if (distance > bestDistance) {
+			bestDistance = distance;
+			best = i;
+		}
+	}
+
+	if (best != -1) {
+		HullFace& face = faces[best];
+		face.outside.push_back(point);
+		if (face.furthest == -1 || bestDistance > face.furthestDistance) {
+			face.furthest = point;
+			face.furthestDistance = bestDistance;
+		}
+	}
+}
+
+// Volume, center of mass and inertia of the solid hull. Sums the
+// tetrahedrons between a point inside and every face, the covariance
+// of each one is found by transforming the covariance of a unit
+// tetrahedron (Blow and Binstock, "How to find the inertia tensor")
+static bool ComputeMassProperties(HullMesh* hull) {
+	int numVertices = (int)hull->vertices.size();
+	Point reference;
+	for (int i = 0; i < numVertices; ++i) {
+		reference = reference + hull->vertices[i];
+	}
+	reference = reference * (1.0f / (float)numVertices);
+
+	float volume6 = 0.0f; // 6 times the volume
+	vec3 centroid;
+	float covariance[3][3] = { { 0 } };
+	for (int i = 0, size = (int)hull->indices.size(); i < size; i += 3) {
+		vec3 a = hull->vertices[hull->indices[i + 0]] - reference;
+		vec3 b = hull->vertices[hull->indices[i + 1]] - reference;
+		vec3 c = hull->vertices[hull->indices[i + 2]] - reference;
+
+		float det = Dot(a, Cross(b, c));
+		volume6 += det;
+		centroid = centroid + (a + b + c) * det;
+
+		for (int j = 0; j < 3; ++j) {
+			for (int k = 0; k < 3; ++k) {
+				covariance[j][k] += det / 120.0f * (
+					2.0f * (a[j] * a[k] + b[j] * b[k] + c[j] * c[k]) +
+					a[j] * b[k] + a[k] * b[j] +
+					a[j] * c[k] + a[k] * c[j] +
+					b[j] * c[k] + b[k] * c[j]
+				);
+			}
+		}
+	}
+
+	if (volume6 <= 0.0f) {
+		return false;
+	}
+
+	float volume = volume6 / 6.0f;
+	centroid = centroid * (1.0f / (4.0f * volume6));
+
+	// Move the covariance to the center of mass
+	for (int j = 0; j < 3; ++j) {
+		for (int k = 0; k < 3; ++k) {
+			covariance[j][k] -= volume * centroid[j] * centroid[k];
+		}
+	}
+
+	float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+	for (int j = 0; j < 3; ++j) {
+		for (int k = 0; k < 3; ++k) {
+			float value = ((j == k) ? trace : 0.0f) - covariance[j][k];
+			hull->inertia.asArray[j * 3 + k] = value / volume; // Mass of 1
+		}
+	}
+
+	hull->volume = volume;
+	hull->centerOfMass = reference + centroid;
+	float radiusSq = 0.0f;
+	for (int i = 0; i < numVertices; ++i) {
+		hull->vertices[i] = hull->vertices[i] - hull->centerOfMass;
+		radiusSq = fmaxf(radiusSq, MagnitudeSq(hull->vertices[i]));
+	}
+	hull->radius = sqrtf(radiusSq);
+
+	// The center of mass is inside, every face is in front of it
+	hull->innerRadius = FLT_MAX;
+	for (int i = 0, size = (int)hull->indices.size(); i < size; i += 3) {
+		const Point& a = hull->vertices[hull->indices[i + 0]];
+		vec3 normal = Cross(hull->vertices[hull->indices[i + 1]] - a, hull->vertices[hull->indices[i + 2]] - a);
+		float lengthSq = MagnitudeSq(normal);
+		if (lengthSq > 0.0f) {
+			hull->innerRadius = fminf(hull->innerRadius, Dot(normal, a) / sqrtf(lengthSq));
+		}
+	}
+
+	return true;
+}
+
+bool BuildConvexHull(const Point* points, int numPoints, HullMesh* outHull, int maxVertices) {
+	if (outHull == 0) {
+		return false;
+	}
+	*outHull = HullMesh();
+	if (points == 0 || numPoints < 4) {
+		return false;
+	}
+
+	// Extreme points along each axis
+	int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	float scale = 0.0f;
+	for (int i = 0; i < numPoints; ++i) {
+		for (int axis = 0; axis < 3; ++axis) {
+			float value = points[i].asArray[axis];
+			if (value < points[extremes[axis * 2]].asArray[axis]) {
+				extremes[axis * 2] = i;
+			}
+			if (value > points[extremes[axis * 2 + 1]].asArray[axis]) {
+				extremes[axis * 2 + 1] = i;
+			}
+			scale = fmaxf(scale, fabsf(value));
+		}
+	}
+	// Anything closer to a face than this counts as on the face
+	float epsilon = scale * 1e-5f;
+
+	// Initial tetrahedron, the two extremes furthest apart, the point
+	// furthest from the line between them, then the point furthest
+	// from the plane through all three
+	int i0 = extremes[0], i1 = extremes[1];
+	for (int axis = 1; axis < 3; ++axis) {
+		if (MagnitudeSq(points[extremes[axis * 2 + 1]] - points[extremes[axis * 2]]) > MagnitudeSq(points[i1] - points[i0])) {
+			i0 = extremes[axis * 2];
+			i1 = extremes[axis * 2 + 1];
+		}
+	}
+	vec3 line = points[i1] - points[i0];
+	float lineLength = Magnitude(line);
+	if (lineLength <= epsilon) {
+		return false;
+	}
+
+	int i2 = -1;
+	float best = epsilon * lineLength;
+	for (int i = 0; i < numPoints; ++i) {
+		float area = Magnitude(Cross(line, points[i] - points[i0]));
+		if (area > best) {
+			best = area;
+			i2 = i;
+		}
+	}
+	if (i2 == -1) {
+		return false; // All points are on a line
+	}
+
+	vec3 normal = Normalized(Cross(line, points[i2] - points[i0]));
+	int i3 = -1;
+	best = epsilon;
+	for (int i = 0; i < numPoints; ++i) {
+		float distance = fabsf(Dot(normal, points[i] - points[i0]));
+		if (distance > best) {
+			best = distance;
+			i3 = i;
+		}
+	}
+	if (i3 == -1) {
+		return false; // All points are on a plane
+	}
+
+	// The hull only grows, so this stays inside of it
+	Point inside = (points[i0] + points[i1] + points[i2] + points[i3]) * 0.25f;
+
+	std::vector<HullFace> faces;
+	faces.reserve(64);
+	faces.resize(4);
+	InitFace(&faces[0], points, i0, i1, i2, inside);
+	InitFace(&faces[1], points, i0, i1, i3, inside);
+	InitFace(&faces[2], points, i0, i2, i3, inside);
+	InitFace(&faces[3], points, i1, i2, i3, inside);
+
+	for (int i = 0; i < numPoints; ++i) {
+		if (i != i0 && i != i1 && i != i2 && i != i3) {
+			AssignPoint(faces, 0, i, points, epsilon);
+		}
+	}
+
+	int numVertices = 4;
+	std::vector<int> horizon; // Pairs of vertex indices
+	std::vector<int> orphans;
+	while (maxVertices <= 0 || numVertices < maxVertices) {
+		// Always add the furthest point first, that way a simplified
+		// hull has the vertices that matter most to its shape
+		int pick = -1;
+		for (int i = 0, size = (int)faces.size(); i < size; ++i) {
+			if (!faces[i].removed && faces[i].furthest != -1) {
+				if (pick == -1 || faces[i].furthestDistance > faces[pick].furthestDistance) {
+					pick = i;
+				}
+			}
+		}
+		if (pick == -1) {
+			break; // No points left outside of the hull
+		}
+
+		int eye = faces[pick].furthest;
+		const Point& eyePoint = points[eye];
+
+		// Remove every face the point can see. The edges that are only
+		// used once by the removed faces make up the horizon. Same as
+		// expanding the polytope in EPA
+		horizon.clear();
+		orphans.clear();
+		int numFaces = (int)faces.size();
+		for (int i = 0; i < numFaces; ++i) {
+			HullFace& face = faces[i];
+			if (face.removed || (i != pick && Dot(face.normal, eyePoint) - face.distance <= epsilon)) {
+				continue;
+			}
+
+			face.removed = true;
+			orphans.insert(orphans.end(), face.outside.begin(), face.outside.end());
+			face.outside.clear();
+
+			for (int e = 0; e < 3; ++e) {
+				int a = face.v[e];
+				int b = face.v[(e + 1) % 3];
+				bool shared = false;
+				for (int j = 0, size = (int)horizon.size(); j < size; j += 2) {
+					if (horizon[j] == b && horizon[j + 1] == a) {
+						horizon[j] = horizon[size - 2];
+						horizon[j + 1] = horizon[size - 1];
+						horizon.resize(size - 2);
+						shared = true;
+						break;
+					}
+				}
+				if (!shared) {
+					horizon.push_back(a);
+					horizon.push_back(b);
+				}
+			}
+		}
+
+		// Connect the horizon to the new point
+		for (int j = 0, size = (int)horizon.size(); j < size; j += 2) {
+			faces.push_back(HullFace());
+			InitFace(&faces.back(), points, horizon[j], horizon[j + 1], eye, inside);
+		}
+		for (int j = 0, size = (int)orphans.size(); j < size; ++j) {
+			if (orphans[j] != eye) {
+				AssignPoint(faces, numFaces, orphans[j], points, epsilon);
+			}
+		}
+
+		numVertices += 1;
+	}
+
+	// Keep only the points used by the remaining faces
+	std::vector<int> remap(numPoints, -1);
+	for (int i = 0, size = (int)faces.size(); i < size; ++i) {
+		if (faces[i].removed) {
+			continue;
+		}
+		for (int k = 0; k < 3; ++k) {
+			int v = faces[i].v[k];
+			if (remap[v] == -1) {
+				remap[v] = (int)outHull->vertices.size();
+				outHull->vertices.push_back(points[v]);
+			}
+			outHull->indices.push_back(remap[v]);
+		}
+	}
+
+	// Every edge is used once in each direction, so following each
+	// edge of each face lists every neighbour exactly once
+	int numHullVertices = (int)outHull->vertices.size();
+	int numIndices = (int)outHull->indices.size();
+	outHull->adjacencyStart.assign(numHullVertices + 1, 0);
+	for (int i = 0; i < numIndices; ++i) {
+		outHull->adjacencyStart[outHull->indices[i] + 1] += 1;
+	}
+	for (int i = 0; i < numHullVertices; ++i) {
+		outHull->adjacencyStart[i + 1] += outHull->adjacencyStart[i];
+	}
+	outHull->adjacency.resize(numIndices);
+	std::vector<int> next(outHull->adjacencyStart.begin(), outHull->adjacencyStart.end() - 1);
+	for (int i = 0; i < numIndices; i += 3) {
+		for (int e = 0; e < 3; ++e) {
+			int a = outHull->indices[i + e];
+			int b = outHull->indices[i + (e + 1) % 3];
+			outHull->adjacency[next[a]++] = b;
+		}
+	}
+
+	if (!ComputeMassProperties(outHull)) {
+		*outHull = HullMesh();
+		return false;
+	}
+	return true;
+}
+
+bool BuildConvexHull(const Mesh& mesh, HullMesh* outHull, int maxVertices) {
+	return BuildConvexHull(mesh.vertices, mesh.numTriangles * 3, outHull, maxVertices);
+}
+
+ConvexHull GetConvexHull(const HullMesh& hullMesh) {
+	ConvexHull result;
+	if (!hullMesh.vertices.empty()) {
+		result.vertices = &hullMesh.vertices[0];
+		result.numVertices = (int)hullMesh.vertices.size();
+		result.adjacencyStart = &hullMesh.adjacencyStart[0];
+		result.adjacency = &hullMesh.adjacency[0];
+	}
+	return result;
+}
+
+ConvexHull GetConvexHull(const HullMesh& hullMesh, const Point& position, const mat3& orientation) {
+	ConvexHull result = GetConvexHull(hullMesh);
+	result.position = position;
+	result.orientation = orientation;
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef _H_QUICK_HULL_
+#define _H_QUICK_HULL_
+
+#include "Geometry3D.h"
+#include <vector>
+
+// The convex hull of a point cloud, built once with Quickhull and then
+// shared by any number of ConvexHull shapes (see GetConvexHull). The
+// vertices are moved so the center of mass is at the origin, the
+// offset they were moved by is kept in centerOfMass.
+typedef struct HullMesh {
+	std::vector<Point> vertices;
+	// 3 per triangle, counter clockwise seen from outside of the hull
+	std::vector<int> indices;
+	// Neighbours of vertex i are adjacency[adjacencyStart[i]] up to
+	// adjacency[adjacencyStart[i + 1]]. Used to hill climb in Support
+	std::vector<int> adjacencyStart;
+	std::vector<int> adjacency;
+
+	Point centerOfMass; // In the space of the points the hull was built from
+	float volume;
+	float radius; // Furthest any vertex is from the center of mass
+	float innerRadius; // Closest any face is to the center of mass
+	mat3 inertia; // Of a solid hull with a mass of 1, about the center of mass
+
+	inline HullMesh() : volume(0.0f), radius(0.0f), innerRadius(0.0f) { }
+} HullMesh;
+
+// Returns false if the points don't span a volume. If maxVertices is
+// more than 0 the hull is simplified, Quickhull stops once it has that
+// many vertices. It always adds the furthest point next, so the hull
+// keeps the overall shape of the points.
+bool BuildConvexHull(const Point* points, int numPoints, HullMesh* outHull, int maxVertices);
+bool BuildConvexHull(const Mesh& mesh, HullMesh* outHull, int maxVertices);
+
+// The shape points into the hull mesh, which must outlive it
+ConvexHull GetConvexHull(const HullMesh& hullMesh);
+ConvexHull GetConvexHull(const HullMesh& hullMesh, const Point& position, const mat3& orientation);
+
+#endif
\ No newline at end of file
@@ -3,11 +3,18 @@
 
 #include <vector>
 #include "Geometry3D.h"
+#include "ConstraintWorld.h"
 
 #define RIGIDBODY_TYPE_BASE		0
 #define RIGIDBODY_TYPE_PARTICLE	1
 #define RIGIDBODY_TYPE_SPHERE	2
 #define RIGIDBODY_TYPE_BOX		3
+#define RIGIDBODY_TYPE_CAPSULE	4
+#define RIGIDBODY_TYPE_HULL		5
+
+// If NO_RENDER is defined, the simulation classes are built
+// without their Render functions. Those live in PhysicsRender.cpp,
+// the rest of the simulation does not need OpenGL to build or link.
 
 class Rigidbody {
 public:
@@ -19,12 +26,17 @@ public:
 	virtual inline ~Rigidbody() { }
 
 	virtual inline void Update(float deltaTime) { }
+#ifndef NO_RENDER
 	virtual inline void Render() { }
+#endif
 	virtual inline void ApplyForces() { }
 	virtual inline void SolveConstraints(const std::vector<OBB>& constraints) { }
+	// Same as above, only tests the boxes near the body
+	virtual inline void SolveConstraints(const ConstraintWorld& world) { }
 
 	inline bool HasVolume() {
-		return type == RIGIDBODY_TYPE_SPHERE || type == RIGIDBODY_TYPE_BOX;
+		return type == RIGIDBODY_TYPE_SPHERE || type == RIGIDBODY_TYPE_BOX ||
+			type == RIGIDBODY_TYPE_CAPSULE || type == RIGIDBODY_TYPE_HULL;
 	}
 };
 
@@ -0,0 +1,262 @@
+#include "RigidbodyStorage.h"
+#include <cmath>
+
+#ifdef SIMD_INTEGRATION
+#include <xmmintrin.h>
+#endif
+
+int RigidbodyStorage::AddBody(const RigidbodyVolume& body) {
+	int handle = (int)mass.size();
+
+	for (int i = 0; i < 3; ++i) {
+		position[i].push_back(0.0f);
+		velocity[i].push_back(0.0f);
+		forces[i].push_back(body.forces.asArray[i]);
+#ifndef LINEAR_ONLY
+		angVel[i].push_back(0.0f);
+		torques[i].push_back(body.torques.asArray[i]);
+#endif
+	}
+#ifndef LINEAR_ONLY
+	for (int i = 0; i < 4; ++i) {
+		orientation[i].push_back(0.0f);
+	}
+
+	// InvTensor is not const
+	RigidbodyVolume copy = body;
+	mat4 inv = copy.InvTensor();
+	float tensor[] = {
+		inv._11, inv._12, inv._13,
+		inv._21, inv._22, inv._23,
+		inv._31, inv._32, inv._33
+	};
+	for (int i = 0; i < 9; ++i) {
+		invTensor[i].push_back(tensor[i]);
+	}
+	angular.push_back((body.type == RIGIDBODY_TYPE_BOX || body.type == RIGIDBODY_TYPE_CAPSULE || body.type == RIGIDBODY_TYPE_HULL) ? 1.0f : 0.0f);
+#endif
+	mass.push_back(body.mass);
+	invMass.push_back((body.mass == 0.0f) ? 0.0f : 1.0f / body.mass);
+
+	SetState(handle, body);
+	return handle;
+}
+
+void RigidbodyStorage::Clear() {
+	for (int i = 0; i < 3; ++i) {
+		position[i].clear();
+		velocity[i].clear();
+		forces[i].clear();
+#ifndef LINEAR_ONLY
+		angVel[i].clear();
+		torques[i].clear();
+#endif
+	}
+#ifndef LINEAR_ONLY
+	for (int i = 0; i < 4; ++i) {
+		orientation[i].clear();
+	}
+	for (int i = 0; i < 9; ++i) {
+		invTensor[i].clear();
+	}
+	angular.clear();
+#endif
+	mass.clear();
+	invMass.clear();
+}
+
+int RigidbodyStorage::Size() {
+	return (int)mass.size();
+}
+
+void RigidbodyStorage::SetState(int handle, const RigidbodyVolume& body) {
+	for (int i = 0; i < 3; ++i) {
+		position[i][handle] = body.position.asArray[i];
+		velocity[i][handle] = body.velocity.asArray[i];
+#ifndef LINEAR_ONLY
+		angVel[i][handle] = body.angVel.asArray[i];
+#endif
+	}
+#ifndef LINEAR_ONLY
+	for (int i = 0; i < 4; ++i) {
+		orientation[i][handle] = body.orientation.asArray[i];
+	}
+#endif
+}
+
+void RigidbodyStorage::Store(int handle, RigidbodyVolume& body) {
+	for (int i = 0; i < 3; ++i) {
+		body.position[i] = position[i][handle];
+		body.velocity[i] = velocity[i][handle];
+		body.forces[i] = forces[i][handle];
+#ifndef LINEAR_ONLY
+		body.angVel[i] = angVel[i][handle];
+#endif
+	}
+#ifndef LINEAR_ONLY
+	for (int i = 0; i < 4; ++i) {
+		body.orientation[i] = orientation[i][handle];
+	}
+#endif
+	body.SynchCollisionVolumes();
+}
+
+void RigidbodyStorage::ApplyForces(int begin, int end) {
+	vec3 gravity = GRAVITY_CONST;
+	if (begin >= end) {
+		return;
+	}
+	const float* m = &mass[0];
+
+	for (int c = 0; c < 3; ++c) {
+		float* f = &forces[c][0];
+		float g = gravity[c];
+		for (int i = begin; i < end; ++i) {
+			f[i] = g * m[i];
+		}
+	}
+}
+
+void RigidbodyStorage::Integrate(float dt, int begin, int end) {
+	// Same as RigidbodyVolume::Update, one component at a time
+	const float damping = 0.98f;
+	if (begin >= end) {
+		return;
+	}
+	const float* im = &invMass[0];
+#ifndef LINEAR_ONLY
+	const float* mask = &angular[0];
+#endif
+
+#ifdef SIMD_INTEGRATION
+	const __m128 dt4 = _mm_set1_ps(dt);
+	const __m128 damping4 = _mm_set1_ps(damping);
+	const __m128 threshold4 = _mm_set1_ps(0.001f);
+	const __m128 signBit4 = _mm_set1_ps(-0.0f);
+	const __m128 zero4 = _mm_setzero_ps();
+#endif
+
+	for (int c = 0; c < 3; ++c) {
+		float* p = &position[c][0];
+		float* v = &velocity[c][0];
+		const float* f = &forces[c][0];
+
+		// Integrate velocity and position
+		int i = begin;
+#ifdef SIMD_INTEGRATION
+		for (; i + 4 <= end; i += 4) {
+			__m128 vel = _mm_mul_ps(_mm_loadu_ps(f + i), _mm_loadu_ps(im + i));
+			vel = _mm_add_ps(_mm_loadu_ps(v + i), _mm_mul_ps(vel, dt4));
+			vel = _mm_mul_ps(vel, damping4);
+			// Zero out lanes where |vel| < threshold
+			__m128 small = _mm_cmplt_ps(_mm_andnot_ps(signBit4, vel), threshold4);
+			vel = _mm_andnot_ps(small, vel);
+			_mm_storeu_ps(v + i, vel);
+
+			__m128 pos = _mm_add_ps(_mm_loadu_ps(p + i), _mm_mul_ps(vel, dt4));
+			_mm_storeu_ps(p + i, pos);
+		}
+#endif
+		for (; i < end; ++i) {
+			float vel = (v[i] + f[i] * im[i] * dt) * damping;
+			v[i] = (fabsf(vel) < 0.001f) ? 0.0f : vel;
+			p[i] = p[i] + v[i] * dt;
+		}
+
+#ifndef LINEAR_ONLY
+		float* w = &angVel[c][0];
+		const float* t0 = &torques[0][0];
+		const float* t1 = &torques[1][0];
+		const float* t2 = &torques[2][0];
+		// Column c of the tensor, torques * tensor like MultiplyVector
+		const float* it0 = &invTensor[c][0];
+		const float* it1 = &invTensor[3 + c][0];
+		const float* it2 = &invTensor[6 + c][0];
+
+		// Only bodies with the angular flag set are integrated,
+		// the select keeps this loop branch free
+		i = begin;
+#ifdef SIMD_INTEGRATION
+		for (; i + 4 <= end; i += 4) {
+			__m128 old = _mm_loadu_ps(w + i);
+			__m128 vel = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_loadu_ps(t0 + i), _mm_loadu_ps(it0 + i)),
+				_mm_mul_ps(_mm_loadu_ps(t1 + i), _mm_loadu_ps(it1 + i))),
+				_mm_mul_ps(_mm_loadu_ps(t2 + i), _mm_loadu_ps(it2 + i)));
+			vel = _mm_add_ps(old, _mm_mul_ps(vel, dt4));
+			vel = _mm_mul_ps(vel, damping4);
+			__m128 small = _mm_cmplt_ps(_mm_andnot_ps(signBit4, vel), threshold4);
+			vel = _mm_andnot_ps(small, vel);
+
+			__m128 active = _mm_cmpneq_ps(_mm_loadu_ps(mask + i), zero4);
+			vel = _mm_or_ps(_mm_and_ps(active, vel), _mm_andnot_ps(active, old));
+			_mm_storeu_ps(w + i, vel);
+		}
+#endif
+		for (; i < end; ++i) {
+			float accel = t0[i] * it0[i] + t1[i] * it1[i] + t2[i] * it2[i];
+			float vel = (w[i] + accel * dt) * damping;
+			vel = (fabsf(vel) < 0.001f) ? 0.0f : vel;
+			w[i] = (mask[i] != 0.0f) ? vel : w[i];
+		}
+#endif
+	}
+
+#ifndef LINEAR_ONLY
+	// Integrate orientation, same as ::Integrate(quat, vec3, float)
+	float* qx = &orientation[0][0];
+	float* qy = &orientation[1][0];
+	float* qz = &orientation[2][0];
+	float* qw = &orientation[3][0];
+	const float* wx = &angVel[0][0];
+	const float* wy = &angVel[1][0];
+	const float* wz = &angVel[2][0];
+	const float halfDt = dt * 0.5f;
+
+	int i = begin;
+#ifdef SIMD_INTEGRATION
+	const __m128 halfDt4 = _mm_set1_ps(halfDt);
+	const __m128 one4 = _mm_set1_ps(1.0f);
+	for (; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(qx + i);
+		__m128 y = _mm_loadu_ps(qy + i);
+		__m128 z = _mm_loadu_ps(qz + i);
+		__m128 w = _mm_loadu_ps(qw + i);
+		__m128 ax = _mm_loadu_ps(wx + i);
+		__m128 ay = _mm_loadu_ps(wy + i);
+		__m128 az = _mm_loadu_ps(wz + i);
+
+		// spin * q, where spin = (angVel, 0)
+		__m128 dx = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(ax, w), _mm_mul_ps(ay, z)), _mm_mul_ps(az, y));
+		__m128 dy = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ay, w), _mm_mul_ps(ax, z)), _mm_mul_ps(az, x));
+		__m128 dz = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ax, y), _mm_mul_ps(ay, x)), _mm_mul_ps(az, w));
+		__m128 dw = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(zero4, _mm_mul_ps(ax, x)), _mm_mul_ps(ay, y)), _mm_mul_ps(az, z));
+
+		__m128 nx = _mm_add_ps(x, _mm_mul_ps(dx, halfDt4));
+		__m128 ny = _mm_add_ps(y, _mm_mul_ps(dy, halfDt4));
+		__m128 nz = _mm_add_ps(z, _mm_mul_ps(dz, halfDt4));
+		__m128 nw = _mm_add_ps(w, _mm_mul_ps(dw, halfDt4));
+
+		__m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)), _mm_mul_ps(nw, nw));
+		__m128 invLen = _mm_div_ps(one4, _mm_sqrt_ps(lenSq));
+
+		__m128 active = _mm_cmpneq_ps(_mm_loadu_ps(mask + i), zero4);
+		_mm_storeu_ps(qx + i, _mm_or_ps(_mm_and_ps(active, _mm_mul_ps(nx, invLen)), _mm_andnot_ps(active, x)));
+		_mm_storeu_ps(qy + i, _mm_or_ps(_mm_and_ps(active, _mm_mul_ps(ny, invLen)), _mm_andnot_ps(active, y)));
+		_mm_storeu_ps(qz + i, _mm_or_ps(_mm_and_ps(active, _mm_mul_ps(nz, invLen)), _mm_andnot_ps(active, z)));
+		_mm_storeu_ps(qw + i, _mm_or_ps(_mm_and_ps(active, _mm_mul_ps(nw, invLen)), _mm_andnot_ps(active, w)));
+	}
+#endif
+	for (; i < end; ++i) {
+		if (mask[i] != 0.0f) {
+			quat q(qx[i], qy[i], qz[i], qw[i]);
+			q = ::Integrate(q, vec3(wx[i], wy[i], wz[i]), dt);
+			qx[i] = q.x;
+			qy[i] = q.y;
+			qz[i] = q.z;
+			qw[i] = q.w;
+		}
+	}
+#endif
+}
\ No newline at end of file
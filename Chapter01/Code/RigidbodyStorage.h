@@ -0,0 +1,59 @@
+#ifndef _H_RIGIDBODY_STORAGE_
+#define _H_RIGIDBODY_STORAGE_
+
+#include "RigidbodyVolume.h"
+#include <vector>
+
+// If SIMD_INTEGRATION is defined, Integrate processes four bodies
+// per instruction using SSE. Bodies left over at the end of the
+// range, or platforms without SSE, use the scalar loop. Both
+// paths produce the same result.
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SIMD_INTEGRATION
+#endif
+
+// Structure of arrays storage for rigid body state. Every
+// property lives in it's own contiguous array, indexed by the
+// handle returned from AddBody. Each vec3 is split into three
+// float arrays (x, y, z) so the force and integration loops
+// are plain float loops that can be vectorized.
+// PhysicsSystem keeps the state of it's volume bodies here. The
+// arrays hold it between steps, the bodies get a copy after each
+// integration through Store.
+
+class RigidbodyStorage {
+public:
+	std::vector<float> position[3];
+	std::vector<float> velocity[3];
+	std::vector<float> forces[3];
+#ifndef LINEAR_ONLY
+	std::vector<float> orientation[4]; // Quaternion x, y, z, w
+	std::vector<float> angVel[3];
+	std::vector<float> torques[3];
+	// Body space, row major. The same tensor RigidbodyVolume::Update
+	// uses, products of inertia included
+	std::vector<float> invTensor[9];
+	std::vector<float> angular; // 1 if angular motion is integrated, 0 if not
+#endif
+	std::vector<float> mass;
+	std::vector<float> invMass;
+public:
+	// Copies all of body in, mass and inertia are only read here
+	int AddBody(const RigidbodyVolume& body);
+	void Clear();
+	int Size();
+
+	// Copies position, velocity, orientation and angular velocity of
+	// body in, for when something other than Integrate moved it
+	void SetState(int handle, const RigidbodyVolume& body);
+	// Copies the state out to body and moves it's collision volumes
+	void Store(int handle, RigidbodyVolume& body);
+
+	// Bodies [begin, end). Ranges that don't overlap can run on
+	// different threads
+	void ApplyForces(int begin, int end);
+	void Integrate(float dt, int begin, int end);
+};
+
+#endif
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "RigidbodyVolume.h"
 #include "Compare.h"
-#include "FixedFunctionPrimitives.h"
+#include "GJK.h"
 
 void RigidbodyVolume::ApplyForces() {
 	forces = GRAVITY_CONST * mass;
@@ -30,25 +30,24 @@ float RigidbodyVolume::InvMass() {
 void RigidbodyVolume::SynchCollisionVolumes() {
 	sphere.position = position;
 	box.position = position;
+	capsule.position = position;
+	if (hullMesh != 0) {
+		hull = GetConvexHull(*hullMesh);
+	}
+	hull.position = position;
 
 #ifndef LINEAR_ONLY
-	box.orientation = Rotation3x3(
-		RAD2DEG(orientation.x),
-		RAD2DEG(orientation.y),
-		RAD2DEG(orientation.z)
-	);
+	box.orientation = ToMat3(orientation);
+	capsule.orientation = box.orientation;
+	hull.orientation = box.orientation;
 #endif
 }
 
-void RigidbodyVolume::Render() {
-	SynchCollisionVolumes();
-
-	if (type == RIGIDBODY_TYPE_SPHERE) {
-		::Render(sphere);
-	}
-	else if (type == RIGIDBODY_TYPE_BOX) {
-		::Render(box);
-	}
+void RigidbodyVolume::SynchCollisionPositions() {
+	sphere.position = position;
+	box.position = position;
+	capsule.position = position;
+	hull.position = position;
 }
 
 #ifndef LINEAR_ONLY
@@ -61,6 +60,17 @@ mat4 RigidbodyVolume::InvTensor() {
 			0, 0, 0, 0
 		);
 	}
+	if (type == RIGIDBODY_TYPE_HULL && hullMesh != 0) {
+		// Only diagonal if the hull is symmetric, invert all of it
+		mat3 inv = Inverse(hullMesh->inertia * mass);
+		return mat4(
+			inv._11, inv._12, inv._13, 0,
+			inv._21, inv._22, inv._23, 0,
+			inv._31, inv._32, inv._33, 0,
+			0, 0, 0, 1
+		);
+	}
+
 	float ix = 0.0f;
 	float iy = 0.0f;
 	float iz = 0.0f;
@@ -88,12 +98,47 @@ mat4 RigidbodyVolume::InvTensor() {
 		iz = (x2 + y2) * mass * fraction;
 		iw = 1.0f;
 	}
+	else if (mass != 0 && type == RIGIDBODY_TYPE_CAPSULE) {
+		// A cylinder and two half spheres, mass split by volume. The
+		// half spheres are moved out to the ends of the cylinder
+		float r = capsule.radius;
+		float h = capsule.halfHeight * 2.0f; // Height of the cylinder
+		float r2 = r * r;
+		float cylinderVolume = 3.14159265f * r2 * h;
+		float sphereVolume = (4.0f / 3.0f) * 3.14159265f * r2 * r;
+		float cylinderMass = mass * cylinderVolume / (cylinderVolume + sphereVolume);
+		float sphereMass = mass - cylinderMass; // Both halves
+
+		float axial = cylinderMass * r2 * 0.5f + sphereMass * r2 * (2.0f / 5.0f);
+		float side = cylinderMass * (h * h / 12.0f + r2 / 4.0f) +
+			sphereMass * (r2 * (2.0f / 5.0f) + h * h / 4.0f + 3.0f * h * r / 8.0f);
+
+		ix = side;
+		iy = axial; // The segment is along local Y
+		iz = side;
+		iw = 1.0f;
+	}
+
+	// The tensor is diagonal, it's inverse is just the reciprocal
+	// of each element. No need to run a full 4x4 inverse on it.
+	return mat4(
+		(ix == 0.0f) ? 0.0f : 1.0f / ix, 0, 0, 0,
+		0, (iy == 0.0f) ? 0.0f : 1.0f / iy, 0, 0,
+		0, 0, (iz == 0.0f) ? 0.0f : 1.0f / iz, 0,
+		0, 0, 0, iw);
+}
+
+mat3 RigidbodyVolume::InvTensorWorld() {
+	mat4 inv = InvTensor();
+	mat3 local(
+		inv._11, inv._12, inv._13,
+		inv._21, inv._22, inv._23,
+		inv._31, inv._32, inv._33
+	);
 
-	return Inverse(mat4(
-		ix, 0, 0, 0,
-		0, iy, 0, 0,
-		0, 0, iz, 0,
-		0, 0, 0, iw));
+	// Row vectors, world = R^T * I^-1 * R
+	mat3 rotation = box.orientation;
+	return Transpose(rotation) * local * rotation;
 }
 #endif
 
@@ -116,7 +161,7 @@ void RigidbodyVolume::Update(float dt) {
 	}
 
 #ifndef LINEAR_ONLY
-	if (type == RIGIDBODY_TYPE_BOX) {
+	if (type == RIGIDBODY_TYPE_BOX || type == RIGIDBODY_TYPE_CAPSULE || type == RIGIDBODY_TYPE_HULL) {
 		vec3 angAccel = MultiplyVector(torques, InvTensor());
 		angVel = angVel + angAccel * dt;
 		angVel = angVel *  damping;
@@ -137,150 +182,289 @@ void RigidbodyVolume::Update(float dt) {
 	position = position + velocity * dt;
 
 #ifndef LINEAR_ONLY
-	if (type == RIGIDBODY_TYPE_BOX) {
-		orientation = orientation + angVel * dt;
+	if (type == RIGIDBODY_TYPE_BOX || type == RIGIDBODY_TYPE_CAPSULE || type == RIGIDBODY_TYPE_HULL) {
+		orientation = Integrate(orientation, angVel, dt);
 	}
 #endif
 
 	SynchCollisionVolumes();
 }
 
-CollisionManifold FindCollisionFeatures(RigidbodyVolume& ra, RigidbodyVolume& rb) {
-	CollisionManifold result;
-	ResetCollisionManifold(&result);
+bool GetConvexShape(const RigidbodyVolume& body, ConvexShape* outShape) {
+	if (body.type == RIGIDBODY_TYPE_SPHERE) {
+		*outShape = ConvexShape(body.sphere);
+		return true;
+	}
+	else if (body.type == RIGIDBODY_TYPE_BOX) {
+		*outShape = ConvexShape(body.box);
+		return true;
+	}
+	else if (body.type == RIGIDBODY_TYPE_CAPSULE) {
+		*outShape = ConvexShape(body.capsule);
+		return true;
+	}
+	else if (body.type == RIGIDBODY_TYPE_HULL && body.hull.numVertices != 0) {
+		*outShape = ConvexShape(body.hull);
+		return true;
+	}
+	return false;
+}
 
-	if (ra.type == RIGIDBODY_TYPE_SPHERE) {
-		if (rb.type == RIGIDBODY_TYPE_SPHERE) {
-			result = FindCollisionFeatures(ra.sphere, rb.sphere);
-		}
-		else if (rb.type == RIGIDBODY_TYPE_BOX) {
-			result = FindCollisionFeatures(rb.box, ra.sphere);
-			result.normal = result.normal * -1.0f;
-		}
+float BoundingRadius(const RigidbodyVolume& body) {
+	if (body.type == RIGIDBODY_TYPE_SPHERE) {
+		return body.sphere.radius;
 	}
-	else if (ra.type == RIGIDBODY_TYPE_BOX) {
-		if (rb.type == RIGIDBODY_TYPE_BOX) {
-			result = FindCollisionFeatures(ra.box, rb.box);
-		}
-		else if (rb.type == RIGIDBODY_TYPE_SPHERE) {
-			result = FindCollisionFeatures(ra.box, rb.sphere);
+	else if (body.type == RIGIDBODY_TYPE_BOX) {
+		return Magnitude(body.box.size);
+	}
+	else if (body.type == RIGIDBODY_TYPE_CAPSULE) {
+		return body.capsule.radius + body.capsule.halfHeight;
+	}
+	else if (body.type == RIGIDBODY_TYPE_HULL && body.hullMesh != 0) {
+		return body.hullMesh->radius;
+	}
+	return 0.0f;
+}
+
+float InnerRadius(const RigidbodyVolume& body) {
+	if (body.type == RIGIDBODY_TYPE_SPHERE) {
+		return body.sphere.radius;
+	}
+	else if (body.type == RIGIDBODY_TYPE_BOX) {
+		return fminf(body.box.size.x, fminf(body.box.size.y, body.box.size.z));
+	}
+	else if (body.type == RIGIDBODY_TYPE_CAPSULE) {
+		return body.capsule.radius;
+	}
+	else if (body.type == RIGIDBODY_TYPE_HULL && body.hullMesh != 0) {
+		return body.hullMesh->innerRadius;
+	}
+	return 0.0f;
+}
+
+void FindCollisionFeatures(RigidbodyVolume& ra, RigidbodyVolume& rb, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+
+	// Hulls go through GJK, which costs a lot more than this even
+	// when it finds a separating axis on the first try
+	if (ra.type == RIGIDBODY_TYPE_HULL || rb.type == RIGIDBODY_TYPE_HULL) {
+		float radius = BoundingRadius(ra) + BoundingRadius(rb);
+		if (MagnitudeSq(ra.position - rb.position) > radius * radius) {
+			return;
 		}
 	}
 
+	ConvexShape a, b;
+	if (GetConvexShape(ra, &a) && GetConvexShape(rb, &b)) {
+		FindCollisionFeatures(a, b, result);
+	}
+}
 
+CollisionManifold FindCollisionFeatures(RigidbodyVolume& ra, RigidbodyVolume& rb) {
+	CollisionManifold result;
+	FindCollisionFeatures(ra, rb, &result);
 	return result;
 }
 
-void ApplyImpulse(RigidbodyVolume& A, RigidbodyVolume& B, const CollisionManifold& M, int c) {
-	// Linear impulse
-	float invMass1 = A.InvMass();
-	float invMass2 = B.InvMass();
-	float invMassSum = invMass1 + invMass2;
+// How far A is moved into B to find the contacts of a speculative pair
+#define SPECULATIVE_OVERLAP 0.005f
 
-	if (invMassSum == 0.0f) {
-		return; // Both objects have infinate mass!
+void FindSpeculativeFeatures(RigidbodyVolume& ra, RigidbodyVolume& rb, float dt, CollisionManifold* result) {
+	ResetCollisionManifold(result);
+	if (ra.InvMass() + rb.InvMass() == 0.0f) {
+		return;
 	}
 
+	// Furthest any point of A can get towards B in this step
+	float radiusA = BoundingRadius(ra);
+	float radiusB = BoundingRadius(rb);
+	float margin = Magnitude(rb.velocity - ra.velocity) * dt;
 #ifndef LINEAR_ONLY
-	vec3 r1 = M.contacts[c] - A.position;
-	vec3 r2 = M.contacts[c] - B.position;
-	mat4 i1 = A.InvTensor();
-	mat4 i2 = B.InvTensor();
+	margin += (Magnitude(ra.angVel) * radiusA + Magnitude(rb.angVel) * radiusB) * dt;
 #endif
+	float reach = radiusA + radiusB + margin;
+	if (margin <= 0.0f || MagnitudeSq(rb.position - ra.position) > reach * reach) {
+		return;
+	}
+
+	ConvexShape a, b;
+	Point closestA, closestB;
+	if (!GetConvexShape(ra, &a) || !GetConvexShape(rb, &b)) {
+		return;
+	}
+	float gap = GJKDistance(a, b, &closestA, &closestB);
+	if (gap >= margin) {
+		return;
+	}
+	if (gap <= 0.0f) {
+		// Touching, but too lightly for the shape tests to catch. This
+		// happens after a speculative contact closed the gap exactly
+		FindCollisionFeaturesGJK(a, b, result);
+		return;
+	}
+	vec3 normal = (closestB - closestA) * (1.0f / gap);
+
+	// One contact, so the solver closes the gap exactly. At the closest
+	// points a box falling flat would be pushed on one corner and spin,
+	// so move A until it just overlaps B and use the middle of the
+	// contacts found there, where the pair will touch
+	Point contact = (closestA + closestB) * 0.5f;
+	float shift = gap + SPECULATIVE_OVERLAP;
+	RigidbodyVolume moved = ra;
+	moved.position = ra.position + normal * shift;
+	moved.SynchCollisionPositions();
+	FindCollisionFeatures(moved, rb, result);
+	if (result->colliding && result->numContacts > 0 && Dot(result->normal, normal) > 0.0f) {
+		vec3 sum;
+		for (int i = 0; i < result->numContacts; ++i) {
+			sum = sum + result->contacts[i];
+		}
+		contact = sum * (1.0f / (float)result->numContacts) - normal * (shift * 0.5f);
+	}
+
+	ResetCollisionManifold(result);
+	result->colliding = true;
+	result->normal = normal;
+	result->depth = -gap;
+	result->contacts[0] = contact;
+	result->depths[0] = -gap;
+	result->numContacts = 1;
+}
+
+void PrepareContact(ContactConstraint* outContact, RigidbodyVolume& A, RigidbodyVolume& B, const CollisionManifold& M, int c) {
+	ContactConstraint& C = *outContact;
+	C.A = &A;
+	C.B = &B;
+	C.invMass1 = A.InvMass();
+	C.invMass2 = B.InvMass();
+	float invMassSum = C.invMass1 + C.invMass2;
+	float numContacts = (float)M.numContacts;
+
+	// Relative collision normal
+	C.normal = Normalized(M.normal);
+
+	// Any two axis perpendicular to the normal make a friction basis
+	if (fabsf(C.normal.x) >= 0.57735f) {
+		C.tangent[0] = Normalized(vec3(C.normal.y, -C.normal.x, 0.0f));
+	}
+	else {
+		C.tangent[0] = Normalized(vec3(0.0f, C.normal.z, -C.normal.y));
+	}
+	C.tangent[1] = Cross(C.normal, C.tangent[0]);
 
-	// Relative velocity
 #ifndef LINEAR_ONLY
-	vec3 relativeVel = (B.velocity + Cross(B.angVel, r2)) - (A.velocity + Cross(A.angVel, r1));
+	C.r1 = M.contacts[c] - A.position;
+	C.r2 = M.contacts[c] - B.position;
+	const mat3& i1 = A.invTensorWorld;
+	const mat3& i2 = B.invTensorWorld;
+
+	C.angularNormal1 = MultiplyVector(Cross(C.r1, C.normal), i1);
+	C.angularNormal2 = MultiplyVector(Cross(C.r2, C.normal), i2);
+	float denominator = invMassSum + Dot(C.normal,
+		Cross(C.angularNormal1, C.r1) + Cross(C.angularNormal2, C.r2));
 #else
-	vec3 relativeVel = B.velocity - A.velocity;
+	float denominator = invMassSum;
 #endif
-	// Relative collision normal
-	vec3 relativeNorm = M.normal;
-	Normalize(relativeNorm);
+	C.normalMass = (denominator == 0.0f) ? 0.0f : 1.0f / (denominator * numContacts);
 
-	// Moving away from each other? Do nothing!
-	if (Dot(relativeVel, relativeNorm) > 0.0f) {
-		return;
+	for (int i = 0; i < 2; ++i) {
+#ifndef LINEAR_ONLY
+		C.angularTangent1[i] = MultiplyVector(Cross(C.r1, C.tangent[i]), i1);
+		C.angularTangent2[i] = MultiplyVector(Cross(C.r2, C.tangent[i]), i2);
+		denominator = invMassSum + Dot(C.tangent[i],
+			Cross(C.angularTangent1[i], C.r1) + Cross(C.angularTangent2[i], C.r2));
+#else
+		denominator = invMassSum;
+#endif
+		C.tangentMass[i] = (denominator == 0.0f) ? 0.0f : 1.0f / (denominator * numContacts);
 	}
 
+	// Restitution is based on the velocity going into the collision,
+	// not on whatever the previous iteration left behind
+#ifndef LINEAR_ONLY
+	vec3 relativeVel = (B.velocity + Cross(B.angVel, C.r2)) - (A.velocity + Cross(A.angVel, C.r1));
+#else
+	vec3 relativeVel = B.velocity - A.velocity;
+#endif
 	float e = fminf(A.cor, B.cor);
+	float vn = Dot(relativeVel, C.normal);
+	C.bias = (vn < 0.0f) ? -e * vn : 0.0f;
 
-	float numerator = (-(1.0f + e) * Dot(relativeVel, relativeNorm));
-	float d1 = invMassSum;
-#ifndef LINEAR_ONLY
-	vec3 d2 = Cross(MultiplyVector(Cross(r1, relativeNorm), i1), r1);
-	vec3 d3 = Cross(MultiplyVector(Cross(r2, relativeNorm), i2), r2);
-	float denominator = d1 + Dot(relativeNorm, d2 + d3);
+#ifdef DYNAMIC_FRICTION
+	C.staticFriction = sqrtf(A.staticFriction * B.staticFriction);
+	C.dynamicFriction = sqrtf(A.dynamicFriction * B.dynamicFriction);
 #else
-	float denominator = d1;
+	C.friction = sqrtf(A.friction * B.friction);
 #endif
+}
 
-	float j = (denominator == 0.0f) ? 0.0f : numerator / denominator;
-	if (M.contacts.size() > 0.0f && j != 0.0f) {
-		j /= (float)M.contacts.size();
+void ApplyImpulse(ContactConstraint& C) {
+	if (C.invMass1 + C.invMass2 == 0.0f) {
+		return; // Both objects have infinate mass!
 	}
 
-	vec3 impulse = relativeNorm * j;
-	A.velocity = A.velocity - impulse *  invMass1;
-	B.velocity = B.velocity + impulse *  invMass2;
+	RigidbodyVolume& A = *C.A;
+	RigidbodyVolume& B = *C.B;
 
+	// Relative velocity
 #ifndef LINEAR_ONLY
-	A.angVel = A.angVel - MultiplyVector(Cross(r1, impulse), i1);
-	B.angVel = B.angVel + MultiplyVector(Cross(r2, impulse), i2);
+	vec3 relativeVel = (B.velocity + Cross(B.angVel, C.r2)) - (A.velocity + Cross(A.angVel, C.r1));
+#else
+	vec3 relativeVel = B.velocity - A.velocity;
 #endif
 
-	// Friction
-	vec3 t = relativeVel - (relativeNorm * Dot(relativeVel, relativeNorm));
-	if (CMP(MagnitudeSq(t), 0.0f)) {
+	// Moving away from each other? Do nothing! A speculative contact
+	// has a negative bias, they can get closer until the gap is closed
+	float vn = Dot(relativeVel, C.normal);
+	if (vn > fminf(C.bias, 0.0f)) {
 		return;
 	}
-	Normalize(t);
 
-	numerator = -Dot(relativeVel, t);
-	d1 = invMassSum;
+	float j = (C.bias - vn) * C.normalMass;
+
+	vec3 impulse = C.normal * j;
+	A.velocity = A.velocity - impulse * C.invMass1;
+	B.velocity = B.velocity + impulse * C.invMass2;
+
 #ifndef LINEAR_ONLY
-	d2 = Cross(MultiplyVector(Cross(r1, t), i1), r1);
-	d3 = Cross(MultiplyVector(Cross(r2, t), i2), r2);
-	denominator = d1 + Dot(t, d2 + d3);
-#else
-	denominator = d1;
+	A.angVel = A.angVel - C.angularNormal1 * j;
+	B.angVel = B.angVel + C.angularNormal2 * j;
 #endif
 
-	float jt = (denominator == 0.0f) ? 0.0f : numerator / denominator;
-	if (M.contacts.size() > 0.0f && jt != 0.0f) {
-		jt /= (float)M.contacts.size();
-	}
-
-	if (CMP(jt, 0.0f)) {
+	// Friction
+	vec3 tangentVel = relativeVel - (C.normal * vn);
+	float jt[2] = {
+		-Dot(tangentVel, C.tangent[0]) * C.tangentMass[0],
+		-Dot(tangentVel, C.tangent[1]) * C.tangentMass[1]
+	};
+	float jtSq = jt[0] * jt[0] + jt[1] * jt[1];
+
+	if (CMP(jtSq, 0.0f)) {
 		return;
 	}
 
-	vec3 tangentImpuse;
+	// Clamp to the friction cone
 #ifdef DYNAMIC_FRICTION
-	float sf = sqrtf(A.staticFriction * B.staticFriction);
-	float df = sqrtf(A.dynamicFriction * B.dynamicFriction);
-	if (fabsf(jt) < j * sf) {
-		tangentImpuse = t * jt;
-	}
-	else {
-		tangentImpuse = t * -j * df;
+	if (jtSq >= j * j * C.staticFriction * C.staticFriction) {
+		float scale = j * C.dynamicFriction / sqrtf(jtSq);
+		jt[0] *= scale;
+		jt[1] *= scale;
 	}
 #else
-	float friction = sqrtf(A.friction * B.friction);
-	if (jt > j * friction) {
-		jt = j * friction;
-	}
-	else if (jt < -j * friction) {
-		jt = -j * friction;
+	float maxFriction = j * C.friction;
+	if (jtSq > maxFriction * maxFriction) {
+		float scale = maxFriction / sqrtf(jtSq);
+		jt[0] *= scale;
+		jt[1] *= scale;
 	}
-	tangentImpuse = t * jt;
 #endif
 
-	A.velocity = A.velocity - tangentImpuse *  invMass1;
-	B.velocity = B.velocity + tangentImpuse *  invMass2;
+	vec3 tangentImpuse = C.tangent[0] * jt[0] + C.tangent[1] * jt[1];
+	A.velocity = A.velocity - tangentImpuse * C.invMass1;
+	B.velocity = B.velocity + tangentImpuse * C.invMass2;
 
 #ifndef LINEAR_ONLY
-	A.angVel = A.angVel - MultiplyVector(Cross(r1, tangentImpuse), i1);
-	B.angVel = B.angVel + MultiplyVector(Cross(r2, tangentImpuse), i2);
+	A.angVel = A.angVel - (C.angularTangent1[0] * jt[0] + C.angularTangent1[1] * jt[1]);
+	B.angVel = B.angVel + (C.angularTangent2[0] * jt[0] + C.angularTangent2[1] * jt[1]);
 #endif
 }
\ No newline at end of file
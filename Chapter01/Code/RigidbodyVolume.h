@@ -2,6 +2,8 @@
 #define _H_MASS_RIGIDBODY_
 
 #include "Rigidbody.h"
+#include "QuickHull.h"
+#include "GJK.h"
 
 #define GRAVITY_CONST vec3(0.0f, -9.82f, 0.0f)
 
@@ -11,7 +13,7 @@ public:
 	vec3 velocity;
 
 #ifndef LINEAR_ONLY
-	vec3 orientation;
+	quat orientation; // Kept normalized
 	vec3 angVel;
 #endif
 
@@ -32,17 +34,36 @@ public:
 
 	OBB box;
 	Sphere sphere;
+	Capsule capsule;
+	ConvexHull hull;
+	// Shared by every body with the same hull, it must outlive them.
+	// Set it before the first SynchCollisionVolumes
+	const HullMesh* hullMesh;
+	// Fast bodies like bullets can pass through thin things in one
+	// step. Continuous bodies are swept from where they were to where
+	// they are after every step, and stopped at the first impact. See
+	// PhysicsSystem::SweepBody
+	bool continuous;
+	// In the RigidbodyStorage of the PhysicsSystem the body was added
+	// to, -1 until it's added. Set by PhysicsSystem::AddRigidbody
+	int handle;
+
+#ifndef LINEAR_ONLY
+	// World space inverse inertia tensor. The physics system
+	// caches this once per step, before solving contacts
+	mat3 invTensorWorld;
+#endif
 public:
 
 	inline RigidbodyVolume() :
 		cor(0.5f), mass(1.0f),
 #ifdef DYNAMIC_FRICTION
 		staticFriction(0.5f),
-		dynamicFriction(0.3f)
+		dynamicFriction(0.3f),
 #else
-		friction(0.6f)
+		friction(0.6f),
 #endif
-		{
+		hullMesh(0), continuous(false), handle(-1) {
 		type = RIGIDBODY_TYPE_BASE;
 	}
 
@@ -50,26 +71,30 @@ public:
 		cor(0.5f), mass(1.0f),
 #ifdef DYNAMIC_FRICTION
 		staticFriction(0.5f),
-		dynamicFriction(0.3f)
+		dynamicFriction(0.3f),
 #else
-		friction(0.6f)
+		friction(0.6f),
 #endif
-		{
+		hullMesh(0), continuous(false), handle(-1) {
 			type = bodyType;
 	}
 
 	virtual ~RigidbodyVolume() { }
 
+#ifndef NO_RENDER
 	virtual void Render();
+#endif
 	virtual void Update(float dt); // Update Position
 
 	float InvMass();
 #ifndef LINEAR_ONLY
 	mat4 InvTensor();
+	mat3 InvTensorWorld();
 #endif
 
 	virtual void ApplyForces();
 	void SynchCollisionVolumes();
+	void SynchCollisionPositions(); // Skips rebuilding the rotation
 
 	virtual void AddLinearImpulse(const vec3& impulse);
 #ifndef LINEAR_ONLY
@@ -77,7 +102,57 @@ public:
 #endif
 };
 
+// Everything about a single contact point that does not change
+// between impulse iterations. It's built once per step by
+// PrepareContact, so ApplyImpulse only has to do multiply-adds.
+typedef struct ContactConstraint {
+	RigidbodyVolume* A;
+	RigidbodyVolume* B;
+
+	vec3 normal;
+	vec3 tangent[2];
+	float invMass1;
+	float invMass2;
+#ifndef LINEAR_ONLY
+	vec3 r1;
+	vec3 r2;
+	// Change in angular velocity per unit of impulse: (r x n) * I^-1
+	vec3 angularNormal1;
+	vec3 angularNormal2;
+	vec3 angularTangent1[2];
+	vec3 angularTangent2[2];
+#endif
+
+	// Inverse effective masses, already divided by the number of
+	// contacts in the manifold
+	float normalMass;
+	float tangentMass[2];
+	// Restitution, target separating velocity. Minus the speed the gap
+	// may be closed at for a speculative contact
+	float bias;
+
+#ifdef DYNAMIC_FRICTION
+	float staticFriction;
+	float dynamicFriction;
+#else
+	float friction;
+#endif
+} ContactConstraint;
+
+void FindCollisionFeatures(RigidbodyVolume& ra, RigidbodyVolume& rb, CollisionManifold* result);
 CollisionManifold FindCollisionFeatures(RigidbodyVolume& ra, RigidbodyVolume& rb);
-void ApplyImpulse(RigidbodyVolume& A, RigidbodyVolume& B, const CollisionManifold& M, int c);
+// For a pair that doesn't touch but could get there in dt at their
+// current velocities. A single contact in the middle of where the pair
+// will touch, its depth is negative, minus the gap between them. Not
+// colliding if the pair can't close the gap this step
+void FindSpeculativeFeatures(RigidbodyVolume& ra, RigidbodyVolume& rb, float dt, CollisionManifold* result);
+// The collision shape of the body, false if it has none
+bool GetConvexShape(const RigidbodyVolume& body, ConvexShape* outShape);
+// Radius of a sphere around the position that holds the whole body
+float BoundingRadius(const RigidbodyVolume& body);
+// Radius of a sphere around the position that is inside of the body
+float InnerRadius(const RigidbodyVolume& body);
+void PrepareContact(ContactConstraint* outContact, RigidbodyVolume& A, RigidbodyVolume& B, const CollisionManifold& M, int c);
+void ApplyImpulse(ContactConstraint& C);
 
 #endif
\ No newline at end of file
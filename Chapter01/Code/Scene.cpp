@@ -1,4 +1,6 @@
 #include "Scene.h"
+#include "JobSystem.h"
+#include "Tracer.h"
 #include <algorithm>
 #include <list>
 
@@ -40,6 +42,7 @@ std::vector<Model*> Scene::FindChildren(const Model* model) {
 }
 
 Model* Scene::Raycast(const Ray& ray) {
+	TRACE_SCOPE("Scene::Raycast");
 	if (octree != 0) {
 		// :: lets the compiler know to look outside class scope
 		return ::Raycast(octree, ray);
@@ -63,7 +66,30 @@ Model* Scene::Raycast(const Ray& ray) {
 	return result;
 }
 
+// Rays per job of a batch raycast
+#define RAYCAST_JOB_GRAIN 32
+
+typedef struct RaycastJobData {
+	Scene* scene;
+	const Ray* rays;
+	Model** outModels;
+} RaycastJobData;
+
+static void RaycastJob(void* data, int begin, int end) {
+	RaycastJobData& job = *(RaycastJobData*)data;
+	for (int i = begin; i < end; ++i) {
+		job.outModels[i] = job.scene->Raycast(job.rays[i]);
+	}
+}
+
+void Scene::Raycast(const Ray* rays, int numRays, Model** outModels) {
+	TRACE_SCOPE("Scene::Raycast batch");
+	RaycastJobData job = { this, rays, outModels };
+	ParallelFor(numRays, RAYCAST_JOB_GRAIN, RaycastJob, &job);
+}
+
 std::vector<Model*> Scene::Query(const Sphere& sphere) {
+	TRACE_SCOPE("Scene::Query");
 	if (octree != 0) {
 		// :: lets the compiler know to look outside class scope
 		return ::Query(octree, sphere);
@@ -80,6 +106,7 @@ std::vector<Model*> Scene::Query(const Sphere& sphere) {
 }
 
 std::vector<Model*> Scene::Query(const AABB& aabb) {
+	TRACE_SCOPE("Scene::Query");
 	if (octree != 0) {
 		// :: lets the compiler know to look outside class scope
 		return ::Query(octree, aabb);
@@ -150,7 +177,7 @@ void Insert(OctreeNode* node, Model* model) {
 
 void Remove(OctreeNode* node, Model* model) {
 	if (node->children == 0) {
-		std::vector<Model*>::iterator it = std::find(node->models.begin(), node->models.end(), model);
+		OctreeModels::iterator it = std::find(node->models.begin(), node->models.end(), model);
 		if (it != node->models.end()) {
 			node->models.erase(it);
 		}
@@ -167,7 +194,7 @@ void Update(OctreeNode* node, Model* model) {
 	Insert(node, model);
 }
 
-Model* FindClosest(const std::vector<Model*>& set, const Ray& ray) {
+Model* FindClosest(const OctreeModels& set, const Ray& ray) {
 	if (set.size() == 0) {
 		return 0;
 	}
@@ -201,7 +228,7 @@ Model* Raycast(OctreeNode* node, const Ray& ray) {
 			return FindClosest(node->models, ray);
 		}
 		else {
-			std::vector<Model*> results;
+			OctreeModels results;
 			for (int i = 0; i < 8; ++i) {
 				Model* result = Raycast(&(node->children[i]), ray);
 				if (result != 0) {
@@ -266,6 +293,7 @@ std::vector<Model*> Query(OctreeNode* node, const AABB& aabb) {
 }
 
 bool Scene::Accelerate(const vec3& position, float size) {
+	TRACE_SCOPE("Scene::Accelerate");
 	if (octree != 0) {
 		return false;
 	}
@@ -287,6 +315,7 @@ bool Scene::Accelerate(const vec3& position, float size) {
 }
 
 std::vector<Model*> Scene::Cull(const Frustum& f) {
+	TRACE_SCOPE("Scene::Cull");
 	std::vector<Model*> result;
 
 	for (int i = 0, size = objects.size(); i < size; ++i) {
@@ -4,10 +4,12 @@
 #include "Geometry3D.h"
 #include <vector>
 
+typedef std::vector<Model*, TaggedAllocator<Model*, MEMORY_TAG_OCTREE> > OctreeModels;
+
 typedef struct OctreeNode {
 	AABB bounds;
 	OctreeNode* children;
-	std::vector<Model*> models;
+	OctreeModels models;
 
 	inline OctreeNode() : children(0) { }
 	inline ~OctreeNode() {
@@ -15,6 +17,7 @@ typedef struct OctreeNode {
 			delete[] children;
 		}
 	}
+	TAGGED_NEW_DELETE(MEMORY_TAG_OCTREE)
 } OctreeNode;
 
 class Scene {
@@ -38,6 +41,9 @@ public:
 	std::vector<Model*> FindChildren(const Model* model);
 
 	Model* Raycast(const Ray& ray);
+	// Casts all of the rays on the job system. outModels[i] is the
+	// closest model rays[i] hit, or 0
+	void Raycast(const Ray* rays, int numRays, Model** outModels);
 	std::vector<Model*> Query(const Sphere& sphere);
 	std::vector<Model*> Query(const AABB& aabb);
 
@@ -51,7 +57,7 @@ void Insert(OctreeNode* node, Model* model);
 void Remove(OctreeNode* node, Model* model);
 void Update(OctreeNode* node, Model* model);
 
-Model* FindClosest(const std::vector<Model*>& set, const Ray& ray);
+Model* FindClosest(const OctreeModels& set, const Ray& ray);
 Model* Raycast(OctreeNode* node, const Ray& ray);
 std::vector<Model*> Query(OctreeNode* node, const Sphere& sphere);
 std::vector<Model*> Query(OctreeNode* node, const AABB& aabb);
@@ -1,4 +1,5 @@
 #include "Spring.h"
+#include <cmath>
 
 Spring::Spring(float _k, float _b, float len) {
 	k = _k;
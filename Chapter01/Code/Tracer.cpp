@@ -0,0 +1,141 @@
+#include "Tracer.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+
+#define TRACE_MAX_DEPTH 64
+
+typedef struct TraceEvent {
+	const char* name;
+	long long start; // Nanoseconds since traceEpoch
+	long long duration;
+} TraceEvent;
+
+// Only the owning thread writes events. The count is published
+// after the event is written, so a reader sees complete events
+// (unless the writer wraps around while it is reading)
+typedef struct TraceBuffer {
+	TraceEvent events[TRACE_BUFFER_SIZE];
+	std::atomic<unsigned int> count; // Events written, next index is count % size
+	const char* threadName;
+	int threadId;
+} TraceBuffer;
+
+static std::atomic<bool> traceEnabled(false);
+static std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+// Taken when a thread records it's first event, and when writing
+static std::mutex traceMutex;
+static std::vector<TraceBuffer*> traceBuffers;
+
+// Open events of this thread. A null name is pushed when tracing
+// is off, so that every TraceEnd matches it's TraceBegin
+static thread_local TraceBuffer* threadBuffer = 0;
+static thread_local const char* openNames[TRACE_MAX_DEPTH];
+static thread_local long long openStarts[TRACE_MAX_DEPTH];
+static thread_local int openDepth = 0;
+
+static long long TraceNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+static TraceBuffer* GetThreadBuffer() {
+	if (threadBuffer == 0) {
+		// Never freed, events of finished threads are still written out
+		TraceBuffer* buffer = new TraceBuffer();
+		buffer->count.store(0);
+		buffer->threadName = 0;
+
+		std::lock_guard<std::mutex> lock(traceMutex);
+		buffer->threadId = (int)traceBuffers.size() + 1;
+		traceBuffers.push_back(buffer);
+		threadBuffer = buffer;
+	}
+	return threadBuffer;
+}
+
+void TraceEnable(bool enable) {
+	traceEnabled.store(enable, std::memory_order_relaxed);
+}
+
+bool TraceEnabled() {
+	return traceEnabled.load(std::memory_order_relaxed);
+}
+
+void TraceBegin(const char* name) {
+	if (openDepth >= TRACE_MAX_DEPTH) {
+		openDepth += 1; // Too deep, ignored but still matched
+		return;
+	}
+	bool enabled = traceEnabled.load(std::memory_order_relaxed);
+	openNames[openDepth] = enabled ? name : 0;
+	openStarts[openDepth] = enabled ? TraceNow() : 0;
+	openDepth += 1;
+}
+
+void TraceEnd() {
+	if (openDepth <= 0) {
+		return;
+	}
+	openDepth -= 1;
+	if (openDepth >= TRACE_MAX_DEPTH || openNames[openDepth] == 0) {
+		return;
+	}
+
+	long long end = TraceNow();
+	TraceBuffer* buffer = GetThreadBuffer();
+	unsigned int count = buffer->count.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[count % TRACE_BUFFER_SIZE];
+	event.name = openNames[openDepth];
+	event.start = openStarts[openDepth];
+	event.duration = end - openStarts[openDepth];
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void TraceThreadName(const char* name) {
+	GetThreadBuffer()->threadName = name;
+}
+
+void TraceClear() {
+	std::lock_guard<std::mutex> lock(traceMutex);
+	for (int i = 0, size = traceBuffers.size(); i < size; ++i) {
+		traceBuffers[i]->count.store(0, std::memory_order_release);
+	}
+}
+
+bool TraceWriteJSON(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == 0) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (int i = 0, size = traceBuffers.size(); i < size; ++i) {
+		TraceBuffer* buffer = traceBuffers[i];
+		if (buffer->threadName != 0) {
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",\n", buffer->threadId, buffer->threadName);
+			first = false;
+		}
+
+		// Oldest event first, only the last TRACE_BUFFER_SIZE are kept
+		unsigned int count = buffer->count.load(std::memory_order_acquire);
+		unsigned int begin = (count > TRACE_BUFFER_SIZE) ? count - TRACE_BUFFER_SIZE : 0;
+		for (unsigned int j = begin; j < count; ++j) {
+			const TraceEvent& event = buffer->events[j % TRACE_BUFFER_SIZE];
+			// Timestamps are in microseconds
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n", event.name, buffer->threadId,
+				(double)event.start * 0.001, (double)event.duration * 0.001);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef _H_TRACER_
+#define _H_TRACER_
+
+// Records timed events into a ring buffer per thread and writes them
+// out in the Chrome trace event format. The file opens in
+// chrome://tracing or ui.perfetto.dev, one row per thread.
+// Tracing is compiled in but off until TraceEnable(true) is called.
+// While it's off, a trace scope only checks a flag.
+// If NO_TRACE is defined, the TRACE_ macros compile to nothing.
+
+// Events per thread, older events are overwritten once it's full
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 16384
+#endif
+
+void TraceEnable(bool enable);
+bool TraceEnabled();
+
+// Names must outlive the trace, use string literals
+void TraceBegin(const char* name);
+void TraceEnd();
+void TraceThreadName(const char* name);
+
+// Drops all recorded events. Other threads should not be recording
+void TraceClear();
+// Writes every recorded event to a JSON file. Events recorded while
+// writing may or may not be in the file
+bool TraceWriteJSON(const char* path);
+
+class TraceScope {
+public:
+	inline TraceScope(const char* name) {
+		TraceBegin(name);
+	}
+	inline ~TraceScope() {
+		TraceEnd();
+	}
+};
+
+#ifndef NO_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_BEGIN(name) TraceBegin(name)
+#define TRACE_END() TraceEnd()
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_BEGIN(name)
+#define TRACE_END()
+#endif
+
+#endif
\ No newline at end of file
@@ -854,4 +854,52 @@ vec3 Decompose(const mat3& rot1) {
 	}
 
 	return vec3(x, y, z);
+}
+
+mat3 ToMat3(const quat& q) {
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	return mat3(
+		1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy),
+		2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx),
+		2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy)
+	);
+}
+
+quat ToQuat(const mat3& rot) {
+	quat result;
+	float trace = rot._11 + rot._22 + rot._33;
+
+	if (trace > 0.0f) {
+		float s = 0.5f / sqrtf(trace + 1.0f);
+		result.w = 0.25f / s;
+		result.x = (rot._23 - rot._32) * s;
+		result.y = (rot._31 - rot._13) * s;
+		result.z = (rot._12 - rot._21) * s;
+	}
+	else if (rot._11 > rot._22 && rot._11 > rot._33) {
+		float s = 2.0f * sqrtf(1.0f + rot._11 - rot._22 - rot._33);
+		result.w = (rot._23 - rot._32) / s;
+		result.x = 0.25f * s;
+		result.y = (rot._12 + rot._21) / s;
+		result.z = (rot._13 + rot._31) / s;
+	}
+	else if (rot._22 > rot._33) {
+		float s = 2.0f * sqrtf(1.0f + rot._22 - rot._11 - rot._33);
+		result.w = (rot._31 - rot._13) / s;
+		result.x = (rot._12 + rot._21) / s;
+		result.y = 0.25f * s;
+		result.z = (rot._23 + rot._32) / s;
+	}
+	else {
+		float s = 2.0f * sqrtf(1.0f + rot._33 - rot._11 - rot._22);
+		result.w = (rot._12 - rot._21) / s;
+		result.x = (rot._13 + rot._31) / s;
+		result.y = (rot._23 + rot._32) / s;
+		result.z = 0.25f * s;
+	}
+
+	return result;
 }
\ No newline at end of file
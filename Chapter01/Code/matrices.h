@@ -255,6 +255,10 @@ mat4 Ortho(float left, float right, float bottom, float top, float zNear, float
 
 vec3 Decompose(const mat3& rot);
 
+// Rows of the matrix are the rotated basis vectors, same as Rotation3x3
+mat3 ToMat3(const quat& q);
+quat ToQuat(const mat3& rot); // rot must be orthonormal
+
 #ifndef NO_EXTRAS
 mat3 FastInverse(const mat3& mat);
 mat4 FastInverse(const mat4& mat);
@@ -302,3 +302,87 @@ vec2 Reflection(const vec2& sourceVector, const vec2& normal) {
 vec3 Reflection(const vec3& sourceVector, const vec3& normal) {
 	return sourceVector - normal * (Dot(sourceVector, normal) *  2.0f);
 }
+
+
+quat operator+(const quat& l, const quat& r) {
+	return quat(l.x + r.x, l.y + r.y, l.z + r.z, l.w + r.w);
+}
+
+quat operator*(const quat& l, const quat& r) {
+	return quat(
+		l.w * r.x + l.x * r.w + l.y * r.z - l.z * r.y,
+		l.w * r.y - l.x * r.z + l.y * r.w + l.z * r.x,
+		l.w * r.z + l.x * r.y - l.y * r.x + l.z * r.w,
+		l.w * r.w - l.x * r.x - l.y * r.y - l.z * r.z
+	);
+}
+
+quat operator*(const quat& q, float f) {
+	return quat(q.x * f, q.y * f, q.z * f, q.w * f);
+}
+
+#ifndef NO_EXTRAS
+bool operator==(const quat& l, const quat& r) {
+	return CMP(l.x, r.x) && CMP(l.y, r.y) && CMP(l.z, r.z) && CMP(l.w, r.w);
+}
+
+bool operator!=(const quat& l, const quat& r) {
+	return !(l == r);
+}
+
+std::ostream& operator<<(std::ostream& os, const quat& q) {
+	os << "(" << q.x << ", " << q.y << ", " << q.z << ", " << q.w << ")";
+	return os;
+}
+#endif
+
+float Dot(const quat& l, const quat& r) {
+	return l.x * r.x + l.y * r.y + l.z * r.z + l.w * r.w;
+}
+
+float Magnitude(const quat& q) {
+	return sqrtf(Dot(q, q));
+}
+
+float MagnitudeSq(const quat& q) {
+	return Dot(q, q);
+}
+
+void Normalize(quat& q) {
+	q = q * (1.0f / Magnitude(q));
+}
+
+quat Normalized(const quat& q) {
+	return q * (1.0f / Magnitude(q));
+}
+
+quat Conjugate(const quat& q) {
+	return quat(-q.x, -q.y, -q.z, q.w);
+}
+
+quat QuatAxisAngle(const vec3& axis, float angle) {
+	vec3 n = Normalized(axis);
+	float half = DEG2RAD(angle) * 0.5f;
+	float s = sinf(half);
+	return quat(n.x * s, n.y * s, n.z * s, cosf(half));
+}
+
+vec3 Rotate(const vec3& vector, const quat& q) {
+	// v' = q * v * q^-1, expanded
+	vec3 u(q.x, q.y, q.z);
+	vec3 t = Cross(u, vector) * 2.0f;
+	return vector + t * q.w + Cross(u, t);
+}
+
+quat Integrate(const quat& q, const vec3& angVel, float dt) {
+	// dq/dt = 0.5 * w * q
+	quat spin(angVel.x, angVel.y, angVel.z, 0.0f);
+	quat result = q + (spin * q) * (dt * 0.5f);
+	return Normalized(result);
+}
+
+quat Nlerp(const quat& from, const quat& to, float t) {
+	// q and -q are the same rotation, flip to the closer one
+	quat target = (Dot(from, to) < 0.0f) ? to * -1.0f : to;
+	return Normalized(from * (1.0f - t) + target * t);
+}
@@ -52,6 +52,26 @@ typedef struct vec3 {
 
 } vec3;
 
+// Rotation quaternion, (x, y, z) is the vector part, w the scalar
+typedef struct quat {
+	union {
+		struct {
+			float x;
+			float y;
+			float z;
+			float w;
+		};
+		float asArray[4];
+	};
+
+	inline float& operator[](int i) {
+		return asArray[i];
+	}
+
+	inline quat() : x(0.0f), y(0.0f), z(0.0f), w(1.0f) { }
+	inline quat(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) { }
+} quat;
+
 vec2 operator+(const vec2& l, const vec2& r);
 vec3 operator+(const vec3& l, const vec3& r);
 
@@ -136,4 +156,27 @@ vec3 Perpendicular(const vec3& length, const vec3& direction);
 vec2 Reflection(const vec2& sourceVector, const vec2& normal);
 vec3 Reflection(const vec3& sourceVector, const vec3& normal);
 
+quat operator+(const quat& l, const quat& r);
+quat operator*(const quat& l, const quat& r); // r is applied first, then l
+quat operator*(const quat& q, float f);
+#ifndef NO_EXTRAS
+bool operator==(const quat& l, const quat& r);
+bool operator!=(const quat& l, const quat& r);
+std::ostream& operator<<(std::ostream& os, const quat& q);
+#endif
+
+float Dot(const quat& l, const quat& r);
+float Magnitude(const quat& q);
+float MagnitudeSq(const quat& q);
+void Normalize(quat& q);
+quat Normalized(const quat& q);
+quat Conjugate(const quat& q);
+
+quat QuatAxisAngle(const vec3& axis, float angle); // Angle in degrees
+vec3 Rotate(const vec3& vector, const quat& q);
+// Advance orientation q by world space angular velocity over dt
+quat Integrate(const quat& q, const vec3& angVel, float dt);
+// Normalized linear interpolation, takes the shortest path
+quat Nlerp(const quat& from, const quat& to, float t);
+
 #endif
\ No newline at end of file